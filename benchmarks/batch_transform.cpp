@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Benchmark of the batched pose transformation.
+ *
+ * Compares applying the origin transform subject by subject (as done by
+ * ViconTransformer before) with the batched kernel transform_poses() for
+ * different numbers of subjects.
+ *
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <chrono>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <vicon_transformer/batch_transform.hpp>
+
+using spatial_transformation::Transformation;
+using vicon_transformer::PoseArray;
+using vicon_transformer::SubjectData;
+
+namespace
+{
+constexpr size_t TOTAL_POSES = 50'000'000;
+
+// prevent the compiler from optimising away the benchmarked code
+template <typename T>
+void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename Func>
+double measure_poses_per_second(size_t num_subjects, Func func)
+{
+    const size_t iterations = TOTAL_POSES / num_subjects;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+    {
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return iterations * num_subjects / seconds;
+}
+
+void run(size_t num_subjects)
+{
+    Transformation origin_tf(Eigen::Quaterniond::UnitRandom(),
+                             Eigen::Vector3d::Random());
+
+    std::vector<SubjectData> subjects(num_subjects);
+    for (auto& subject : subjects)
+    {
+        subject.is_visible = true;
+        subject.global_pose = Transformation(Eigen::Quaterniond::UnitRandom(),
+                                             Eigen::Vector3d::Random());
+    }
+    std::vector<SubjectData> output = subjects;
+
+    // one subject at a time
+    double per_subject = measure_poses_per_second(
+        num_subjects,
+        [&]
+        {
+            for (size_t i = 0; i < subjects.size(); i++)
+            {
+                if (subjects[i].is_visible)
+                {
+                    output[i].global_pose = origin_tf * subjects[i].global_pose;
+                }
+            }
+            do_not_optimize(output);
+        });
+
+    // batched, including conversion from/to array-of-structs
+    PoseArray poses, result;
+    double batched = measure_poses_per_second(
+        num_subjects,
+        [&]
+        {
+            poses.gather(subjects);
+            vicon_transformer::transform_poses(origin_tf, poses, result);
+            result.scatter_visible(output);
+            do_not_optimize(output);
+        });
+
+    // kernel only
+    poses.gather(subjects);
+    double kernel = measure_poses_per_second(
+        num_subjects,
+        [&]
+        {
+            vicon_transformer::transform_poses(origin_tf, poses, result);
+            do_not_optimize(result);
+        });
+
+    fmt::print("{:>6} | {:>12.1f} | {:>12.1f} | {:>12.1f}\n",
+               num_subjects,
+               per_subject / 1e6,
+               batched / 1e6,
+               kernel / 1e6);
+}
+}  // namespace
+
+int main()
+{
+    fmt::print("Throughput in million poses per second\n\n");
+    fmt::print("{:>6} | {:>12} | {:>12} | {:>12}\n",
+               "N",
+               "per subject",
+               "batched",
+               "kernel only");
+    for (size_t num_subjects : {10, 100, 1000})
+    {
+        run(num_subjects);
+    }
+
+    return 0;
+}
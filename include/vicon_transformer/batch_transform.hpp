@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Batched transformation of many poses at once.
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <spatial_transformation/transformation.hpp>
+
+#include "types.hpp"
+
+namespace vicon_transformer
+{
+/**
+ * @brief List of poses in structure-of-arrays layout.
+ *
+ * Each component of the rotation quaternions and translations is stored in a
+ * separate, aligned array.  This allows @ref transform_poses() to process
+ * several poses at once using SIMD instructions.
+ */
+struct PoseArray
+{
+    template <typename T>
+    using AlignedVector = std::vector<T, Eigen::aligned_allocator<T>>;
+
+    AlignedVector<double> qw, qx, qy, qz;
+    AlignedVector<double> tx, ty, tz;
+
+    //! Number of poses in the array.
+    size_t size() const
+    {
+        return qw.size();
+    }
+
+    //! Resize all component arrays.
+    void resize(size_t size);
+
+    //! Set the pose at the given index.
+    void set(size_t index, const spatial_transformation::Transformation& pose);
+
+    //! Get the pose at the given index.
+    spatial_transformation::Transformation get(size_t index) const;
+
+    /**
+     * @brief Fill the array with the poses of the given subjects.
+     *
+     * The array is resized to the number of subjects.  Note that the poses of
+     * subjects that are not visible are copied as well.
+     */
+    void gather(const std::vector<SubjectData>& subjects);
+
+    /**
+     * @brief Write the poses back to the given subjects.
+     *
+     * Only the poses of visible subjects are written, the others are left
+     * unchanged.
+     *
+     * @param subjects Subjects to which the poses are written.  Must have the
+     *      same size as the array.
+     */
+    void scatter_visible(std::vector<SubjectData>& subjects) const;
+};
+
+/**
+ * @brief Apply a transformation to all poses of a PoseArray.
+ *
+ * Computes ``result[i] = tf * poses[i]`` for all i.  The loop is written such
+ * that the compiler can vectorise it.  With GCC on x86-64 Linux, it is
+ * compiled for AVX-512, AVX2 and baseline SSE2 and the best variant supported
+ * by the CPU is selected at runtime.  On other platforms, it is vectorised
+ * for the target architecture (e.g. NEON), with plain scalar code being the
+ * fallback.
+ *
+ * Note that converting from/to SubjectData (see @ref PoseArray::gather()) is
+ * more expensive than the transformation itself.  Including the conversion,
+ * transforming all poses of a frame in a batch is still about twice as fast
+ * as transforming them one by one (see benchmarks/batch_transform.cpp), so
+ * this only pays off if all poses are needed.
+ *
+ * @param tf The transformation that is applied.
+ * @param poses Input poses.
+ * @param result Output poses.  Is resized to the size of poses.  Must not be
+ *      the same instance as poses.
+ */
+void transform_poses(const spatial_transformation::Transformation& tf,
+                     const PoseArray& poses,
+                     PoseArray& result);
+
+/**
+ * @brief Extrapolate poses linearly based on their previous values.
+ *
+ * Computes for all i the pose ``result[i]`` that is reached when continuing
+ * the motion from ``previous[i]`` to ``current[i]`` for another ``factor``
+ * times the time between the two.  The translation is extrapolated linearly.
+ * The rotation is extrapolated linearly on the quaternion components and then
+ * normalised, which is a good approximation for the small rotations between
+ * two consecutive frames.  Like @ref transform_poses(), the loop is written
+ * such that the compiler can vectorise it.
+ *
+ * To not extrapolate a pose (e.g. because there is no valid previous value),
+ * set ``previous[i]`` to ``current[i]``.
+ *
+ * @param previous Poses at the previous time step.
+ * @param current Poses at the current time step.  Must have the same size as
+ *      previous.
+ * @param factor Ratio between the extrapolation horizon and the time between
+ *      previous and current.
+ * @param result Output poses.  Is resized to the size of current.  Must not be
+ *      the same instance as one of the inputs.
+ */
+void extrapolate_poses(const PoseArray& previous,
+                       const PoseArray& current,
+                       double factor,
+                       PoseArray& result);
+
+}  // namespace vicon_transformer
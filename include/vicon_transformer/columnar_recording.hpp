@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Column-oriented storage of recordings for fast trajectory access.
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace vicon_transformer
+{
+/**
+ * @brief Pointers to the columns of one subject in a @ref ColumnarRecording.
+ *
+ * All arrays have one entry (or row) per frame of the recording.  If the
+ * subject is not visible in a frame (or not present at all), pose and quality
+ * of that frame are set to zero.
+ */
+struct SubjectColumns
+{
+    //! Global translation (x, y, z), row-major array of shape (num_frames, 3).
+    const double* translation = nullptr;
+    /**
+     * @brief Global rotation quaternion (x, y, z, w), row-major array of shape
+     * (num_frames, 4).
+     */
+    const double* rotation = nullptr;
+    //! Quality of the pose estimation.
+    const double* quality = nullptr;
+    //! 1 if the subject is visible in the frame, 0 if not.
+    const uint8_t* is_visible = nullptr;
+};
+
+/**
+ * @brief Column-oriented copy of (a part of) a recording in memory.
+ *
+ * Same layout as the columns of a @ref ColumnarRecording but owning the data.
+ * See @ref load_recording_columns().
+ */
+struct RecordingColumns
+{
+    //! Columns of one subject (see @ref SubjectColumns for the layout).
+    struct Subject
+    {
+        std::vector<double> translation;
+        std::vector<double> rotation;
+        std::vector<double> quality;
+        std::vector<uint8_t> is_visible;
+    };
+
+    //! Time stamps of the frames (see ViconFrame::time_stamp).
+    std::vector<int64_t> time_stamps;
+    //! Vicon frame numbers of the frames.
+    std::vector<int32_t> frame_numbers;
+    //! Names of all subjects (sorted alphabetically).
+    std::vector<std::string> subject_names;
+    //! Columns of the subjects in the order of subject_names.
+    std::vector<Subject> subjects;
+
+    //! Number of frames.
+    size_t num_frames() const
+    {
+        return time_stamps.size();
+    }
+};
+
+/**
+ * @brief Load a recording (or a time range of it) into columns.
+ *
+ * Like @ref export_columnar_recording() but the result is kept in memory
+ * instead of being written to a file.  This is meant for analysing
+ * recordings without having to iterate over the frames (e.g. from Python).
+ *
+ * The set of subjects is the union of the subjects of all loaded frames.
+ * Values of subjects that are not visible in a frame are zero.
+ *
+ * @param filename Recording in any format supported by PlaybackReceiver.
+ * @param start_time_stamp_ns Only load frames with time stamps not less than
+ *      this (inclusive).
+ * @param end_time_stamp_ns Only load frames with time stamps less than this
+ *      (exclusive).
+ */
+RecordingColumns load_recording_columns(
+    const std::filesystem::path& filename,
+    int64_t start_time_stamp_ns = std::numeric_limits<int64_t>::min(),
+    int64_t end_time_stamp_ns = std::numeric_limits<int64_t>::max());
+
+/**
+ * @brief Convert a recording to a column-oriented file.
+ *
+ * Other than the frame-by-frame layout of recordings (see RecordingWriter),
+ * all values of one kind are stored in a contiguous array (time stamps, frame
+ * numbers and, per subject, translations, rotations, quality and visibility).
+ * Reading the trajectory of a single subject therefore only touches the data
+ * of that subject and does not require decoding any frames.  See @ref
+ * ColumnarRecording for reading the file.
+ *
+ * The set of subjects is the union of the subjects of all frames.
+ *
+ * File format (all integers in little-endian byte order, all columns aligned
+ * to 8 bytes):
+ *
+ * - Header: magic bytes "VICONCOL", format version (uint32), number of
+ *   subjects (uint32), number of frames (uint64), offset of the first column
+ *   (uint64).
+ * - Subject names, each given by its length (uint32) followed by the
+ *   characters.
+ * - Columns: time stamps (int64), frame numbers (int32) and then for each
+ *   subject translation (3 x double), rotation (4 x double), quality (double)
+ *   and visibility (uint8).
+ *
+ * @param input_file Recording in any format supported by PlaybackReceiver.
+ * @param output_file Path to which the columnar file is written.
+ */
+void export_columnar_recording(const std::filesystem::path& input_file,
+                               const std::filesystem::path& output_file);
+
+/**
+ * @brief Read files written by @ref export_columnar_recording().
+ *
+ * The file is memory-mapped and the columns are provided as pointers into the
+ * mapped memory, i.e. without copying.  They stay valid as long as the
+ * instance exists.
+ */
+class ColumnarRecording
+{
+public:
+    //! Current version of the file format.
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    /**
+     * @param filename Path to the file.
+     * @throws std::runtime_error if the file cannot be opened or is not a valid
+     *      columnar recording.
+     */
+    explicit ColumnarRecording(const std::filesystem::path& filename);
+
+    ~ColumnarRecording();
+
+    ColumnarRecording(const ColumnarRecording&) = delete;
+    ColumnarRecording& operator=(const ColumnarRecording&) = delete;
+
+    //! Number of frames in the recording.
+    size_t num_frames() const
+    {
+        return num_frames_;
+    }
+
+    //! Names of all subjects in the recording (sorted alphabetically).
+    const std::vector<std::string>& subject_names() const
+    {
+        return subject_names_;
+    }
+
+    //! Time stamps of the frames (see ViconFrame::time_stamp).
+    const int64_t* time_stamps() const;
+
+    //! Vicon frame numbers of the frames.
+    const int32_t* frame_numbers() const;
+
+    /**
+     * @brief Get the columns of a subject.
+     *
+     * @throws UnknownSubjectError if there is no subject with the given name.
+     */
+    SubjectColumns subject(const std::string& subject_name) const;
+
+    /**
+     * @brief Get the columns of a subject by its index in @ref
+     * subject_names().
+     *
+     * @throws std::out_of_range if the index is invalid.
+     */
+    SubjectColumns subject(size_t subject_index) const;
+
+private:
+    //! Memory-mapped file content.
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    size_t num_frames_ = 0;
+    std::vector<std::string> subject_names_;
+    //! Offset of the first column.
+    uint64_t data_offset_ = 0;
+};
+
+}  // namespace vicon_transformer
@@ -7,15 +7,27 @@
  */
 #pragma once
 
-#include <map>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
 #include <o80/driver.hpp>
 
+#include "errors.hpp"
+#include "subject_registry.hpp"
+#include "triple_buffer.hpp"
 #include "vicon_transformer.hpp"
 
 namespace vicon_transformer
@@ -24,6 +36,20 @@ class None
 {
 };
 
+//! Staleness of the frame returned by @ref o80Driver::get().
+struct FrameStaleness
+{
+    //! Time since the frame was received by the driver (in nanoseconds).
+    int64_t age_ns = 0;
+    /**
+     * @brief Number of frames that were received since the previous call of
+     * get() but were dropped because a newer frame arrived.
+     */
+    uint64_t frames_missed = 0;
+    //! False if the frame was already returned by the previous call of get().
+    bool is_new = true;
+};
+
 /**
  * @brief Generic o80 driver to provide Vicon data.
  *
@@ -41,12 +67,32 @@ class None
  * unexpected name is passed to it.  In this case, the driver will ignore that
  * subject.
  *
+ * The mapping is only evaluated when the set of subjects provided by Vicon
+ * changes, so ``map_name_to_index`` does not need to be fast.
+ *
+ * Instead of writing ``map_name_to_index`` by hand, consider using
+ * @ref o80SubjectListDriver, which generates it from a list of names, or
+ * @ref o80RuntimeSubjectsDriver, where the names are given at runtime.
+ *
  * Subjects for which no information is provided by Vicon will have the
  * ``is_visible`` field set to false.
  *
  * The driver uses @ref ViconTransformer with the given receiver to acquire the
  * Vicon frames and provide poses relative to the specified origin subject.
  *
+ * By default, frames are acquired in @ref get(), so the o80 backend runs at the
+ * rate at which the receiver provides frames and stalls if no frames arrive.
+ * If ``use_acquisition_thread`` is set, acquisition and transformation of the
+ * frames is done in a separate thread instead and @ref get() returns the most
+ * recent frame immediately, without waiting for a new one.  This allows running
+ * the backend at a fixed rate.  How old the returned frame is and how many
+ * frames were dropped is stored in the ``age_ns`` and ``frames_missed`` fields
+ * of the frame, so it is also available to o80 frontends (in C++ it can be
+ * checked with @ref get_staleness() as well).  Frames in which the origin
+ * subject is not visible are skipped (the age of the returned frame increases
+ * in this case).  Other errors terminate the acquisition thread and are
+ * rethrown by @ref get().
+ *
  * @tparam NUM_SUBJECTS Number of subjects.
  * @tparam map_name_to_index Function that maps a subject name to an index in
  *      the subject array.  The indices must be less than ``NUM_SUBJECTS - 1``.
@@ -61,11 +107,15 @@ public:
      *      the subjects that is tracked by Vicon.  Poses of all subjects will
      *      be given relative to the origin subject.
      * @param logger A logger instance used for logging output.
+     * @param use_acquisition_thread If set, frames are acquired in a separate
+     *      thread, so that @ref get() does not block (see class description).
      */
     o80Driver(std::shared_ptr<vicon_transformer::Receiver> receiver,
               const std::string& origin_subject_name,
-              std::shared_ptr<spdlog::logger> logger = nullptr)
-        : vicon_transformer_(receiver, origin_subject_name, logger)
+              std::shared_ptr<spdlog::logger> logger = nullptr,
+              bool use_acquisition_thread = false)
+        : vicon_transformer_(receiver, origin_subject_name, logger),
+          use_acquisition_thread_(use_acquisition_thread)
     {
         if (logger)
         {
@@ -82,14 +132,51 @@ public:
         }
     }
 
+    ~o80Driver()
+    {
+        stop_acquisition_thread();
+    }
+
+    /**
+     * @brief Wait until data of the origin subject is received.
+     *
+     * If the acquisition thread is used, it is started here, so @ref get()
+     * always has a frame to return after this.  Calling this while the
+     * acquisition thread is running has no effect.
+     */
     void start() override
     {
+        if (acquisition_thread_.joinable())
+        {
+            // The running thread updates vicon_transformer_, so it must not be
+            // accessed here.
+            if (!acquisition_failed_)
+            {
+                return;
+            }
+            // a thread that terminated due to an error only needs to be joined
+            stop_acquisition_thread();
+        }
+
         vicon_transformer_.wait_for_origin_subject_data();
+
+        if (use_acquisition_thread_ && !acquisition_thread_.joinable())
+        {
+            convert_frame(latest_frame_.write_buffer());
+            latest_frame_.publish();
+
+            log_->info("Start acquisition thread.");
+            stop_acquisition_ = false;
+            acquisition_error_ = nullptr;
+            acquisition_failed_ = false;
+            acquisition_thread_ =
+                std::thread(&o80Driver::acquisition_loop, this);
+        }
     }
 
     void stop() override
     {
-        // do nothing
+        stop_acquisition_thread();
     }
 
     void set(const None&) override
@@ -97,44 +184,140 @@ public:
         // do nothing
     }
 
+    /**
+     * @brief Get the latest frame.
+     *
+     * Without acquisition thread, this blocks until the next frame is received.
+     * With acquisition thread, the most recent frame is returned immediately
+     * (which may be the same as in the previous call).  Its ``age_ns`` and
+     * ``frames_missed`` fields are set according to @ref get_staleness().
+     *
+     * @throws Any exception that terminated the acquisition thread.
+     */
     FixedSizeViconFrame<NUM_SUBJECTS> get() override
     {
-        // get frame from vicon_transformer_ and convert it to a fixed-size
-        // frame, following the mapping provided by map_name_to_index().
+        if (!use_acquisition_thread_)
+        {
+            AcquiredFrame acquired;
+            vicon_transformer_.update();
+            convert_frame(acquired);
+            staleness_ = FrameStaleness();
+            return acquired.frame;
+        }
 
-        typedef FixedSizeViconFrame<NUM_SUBJECTS> _Fixed;
+        if (acquisition_failed_)
+        {
+            std::rethrow_exception(acquisition_error_);
+        }
 
-        vicon_transformer_.update();
-        ViconFrame frame = vicon_transformer_.get_frame();
+        staleness_.is_new = latest_frame_.swap();
+        const AcquiredFrame& latest = latest_frame_.read_buffer();
+        if (staleness_.is_new)
+        {
+            staleness_.frames_missed = latest.sequence - last_sequence_ - 1;
+            last_sequence_ = latest.sequence;
+        }
+        else
+        {
+            staleness_.frames_missed = 0;
+        }
+        staleness_.age_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - latest.received_at)
+                .count();
 
-        _Fixed fixed_frame;
-        fixed_frame.frame_number = frame.frame_number;
-        fixed_frame.frame_rate = frame.frame_rate;
-        fixed_frame.latency = frame.latency;
-        fixed_frame.time_stamp = frame.time_stamp;
+        FixedSizeViconFrame<NUM_SUBJECTS> frame = latest.frame;
+        frame.age_ns = staleness_.age_ns;
+        frame.frames_missed = staleness_.frames_missed;
+        return frame;
+    }
+
+    //! Staleness of the frame returned by the last call of @ref get().
+    const FrameStaleness& get_staleness() const
+    {
+        return staleness_;
+    }
+
+protected:
+    /**
+     * @brief Map subject name to index in the frame.
+     *
+     * Calls ``map_name_to_index`` by default.  Can be overridden by derived
+     * classes that determine the mapping at runtime.
+     *
+     * @throws UnknownSubjectError if the subject is not expected.
+     */
+    virtual size_t map_subject_name(const std::string& name) const
+    {
+        return map_name_to_index(name);
+    }
+
+private:
+    //! Frame together with information on when it was received.
+    struct AcquiredFrame
+    {
+        FixedSizeViconFrame<NUM_SUBJECTS> frame;
+        std::chrono::steady_clock::time_point received_at;
+        //! Counts the received frames, starting at 1.
+        uint64_t sequence = 0;
+    };
+
+    ViconTransformer vicon_transformer_;
+    std::shared_ptr<spdlog::logger> log_;
+
+    const bool use_acquisition_thread_;
+    //! Number of frames converted so far.
+    uint64_t num_converted_frames_ = 0;
+    FrameStaleness staleness_;
+
+    // Members used if use_acquisition_thread_ is set.
+    std::thread acquisition_thread_;
+    std::atomic<bool> stop_acquisition_ = false;
+    TripleBuffer<AcquiredFrame> latest_frame_;
+    //! Set after acquisition_error_ is written, so get() can read it safely.
+    std::atomic<bool> acquisition_failed_ = false;
+    std::exception_ptr acquisition_error_;
+    //! Sequence number of the frame returned by the last get().
+    uint64_t last_sequence_ = 0;
 
-        for (auto& [name, data] : frame.subjects)
+    //! Name table for which slots_ was computed.
+    std::shared_ptr<const FlatViconFrame::NameTable> slot_names_;
+    //! Index in FixedSizeViconFrame::subjects for each subject of the frame.
+    std::vector<std::optional<size_t>> slots_;
+    //! Unexpected subjects for which a warning was already printed.
+    std::set<std::string> warned_subjects_;
+
+    /**
+     * @brief Update slots_ if the set of subjects changed.
+     *
+     * map_subject_name() is only called when the set of subjects provided
+     * by Vicon changes, not for every frame.
+     */
+    void update_slots()
+    {
+        auto names = vicon_transformer_.get_subject_name_table();
+        if (names == slot_names_)
+        {
+            return;
+        }
+
+        slots_.clear();
+        for (const std::string& name : *names)
         {
             size_t i;
             try
             {
-                i = map_name_to_index(name);
+                i = map_subject_name(name);
             }
             catch (const UnknownSubjectError&)
             {
                 // Ignore unexpected subjects but print a warning the first time
                 // they occur.
-
-                static std::map<std::string, bool> already_warned;
-
-                // bools are value-initialized to false, so if 'name' is not yet
-                // in the map, a new entry will created with the value false.
-                if (!already_warned[name])
+                if (warned_subjects_.insert(name).second)
                 {
                     log_->warn("Ignore unexpected subject '{}'", name);
-                    already_warned[name] = true;
                 }
-
+                slots_.push_back(std::nullopt);
                 continue;
             }
 
@@ -147,16 +330,213 @@ public:
                                 i,
                                 NUM_SUBJECTS));
             }
+            slots_.push_back(i);
+        }
+        slot_names_ = std::move(names);
+    }
+
+    //! Convert the current frame of the transformer to a fixed-size frame.
+    void convert_frame(AcquiredFrame& acquired)
+    {
+        update_slots();
+        vicon_transformer_.get_frame_into(acquired.frame, slots_);
+        acquired.received_at = std::chrono::steady_clock::now();
+        acquired.sequence = ++num_converted_frames_;
+    }
+
+    void acquisition_loop()
+    {
+        bool origin_occluded = false;
+        try
+        {
+            while (!stop_acquisition_)
+            {
+                try
+                {
+                    vicon_transformer_.update();
+                }
+                catch (const SubjectNotVisibleError&)
+                {
+                    // Skip frames in which the origin subject is occluded.
+                    // Consumers notice this by the increasing age of the
+                    // frame.
+                    if (!origin_occluded)
+                    {
+                        log_->warn(
+                            "Origin subject is not visible.  Skip frames "
+                            "until it is visible again.");
+                        origin_occluded = true;
+                    }
+                    continue;
+                }
+                if (origin_occluded)
+                {
+                    log_->info("Origin subject is visible again.");
+                    origin_occluded = false;
+                }
+
+                convert_frame(latest_frame_.write_buffer());
+                latest_frame_.publish();
+            }
+        }
+        catch (...)
+        {
+            log_->error("Acquisition thread terminated due to an error.");
+            acquisition_error_ = std::current_exception();
+            acquisition_failed_ = true;
+        }
+    }
 
-            fixed_frame.subjects[i] = data;
+    /**
+     * @brief Stop the acquisition thread (if running).
+     *
+     * Note that this blocks until the receiver returns the frame it is
+     * currently waiting for.
+     */
+    void stop_acquisition_thread()
+    {
+        if (!acquisition_thread_.joinable())
+        {
+            return;
         }
 
-        return fixed_frame;
+        log_->info("Stop acquisition thread.");
+        stop_acquisition_ = true;
+        acquisition_thread_.join();
+    }
+};
+
+/**
+ * @brief o80Driver for a compile-time list of subject names.
+ *
+ * The number of subjects and the mapping from names to indices are generated
+ * from the given list (see @ref SubjectRegistry), so the index of a subject in
+ * the FixedSizeViconFrame is its position in the list.  Client code can use
+ * ``Subjects`` to map indices back to names.
+ *
+ * @code
+ * struct MySubjects
+ * {
+ *     static constexpr std::array<std::string_view, 2> names = {
+ *         "rll_ping_base", "ball_launcher"};
+ * };
+ *
+ * using Driver = o80SubjectListDriver<MySubjects>;
+ * using Standalone = o80Standalone<Driver>;
+ * @endcode
+ *
+ * @tparam SubjectList See @ref SubjectRegistry.
+ */
+template <typename SubjectList>
+class o80SubjectListDriver
+    : public o80Driver<SubjectRegistry<SubjectList>::size,
+                       &SubjectRegistry<SubjectList>::map_name_to_index>
+{
+public:
+    //! Mapping between subject names and indices in the frame.
+    using Subjects = SubjectRegistry<SubjectList>;
+
+    using o80Driver<Subjects::size, &Subjects::map_name_to_index>::o80Driver;
+};
+
+namespace internal
+{
+//! Placeholder for ``map_name_to_index`` that does not accept any subject.
+inline size_t reject_subject_name(const std::string& name)
+{
+    throw UnknownSubjectError(name);
+}
+}  // namespace internal
+
+/**
+ * @brief o80Driver with subject names that are configured at runtime.
+ *
+ * The frame has a fixed capacity of ``MAX_SUBJECTS`` subjects, but which
+ * subjects are tracked is specified when constructing the driver, so the set of
+ * subjects can be changed without recompiling.  The index of a subject in the
+ * FixedSizeViconFrame is its position in the list of names.  Slots beyond the
+ * number of configured subjects are never visible.
+ *
+ * Since the names are not part of the observations, clients need to get them
+ * in a different way, e.g. from shared memory (see
+ * @ref publish_o80_subject_names()).
+ *
+ * @tparam MAX_SUBJECTS Maximum number of subjects.
+ */
+template <size_t MAX_SUBJECTS>
+class o80RuntimeSubjectsDriver
+    : public o80Driver<MAX_SUBJECTS, &internal::reject_subject_name>
+{
+public:
+    /**
+     * @param receiver See o80Driver.
+     * @param origin_subject_name See o80Driver.
+     * @param subject_names Names of the subjects that are provided in the
+     *      frame, in the order in which they are provided.
+     * @param logger See o80Driver.
+     * @param use_acquisition_thread See o80Driver.
+     *
+     * @throws std::invalid_argument if there are more than MAX_SUBJECTS names
+     *      or if names are empty or not unique.
+     */
+    o80RuntimeSubjectsDriver(
+        std::shared_ptr<vicon_transformer::Receiver> receiver,
+        const std::string& origin_subject_name,
+        const std::vector<std::string>& subject_names,
+        std::shared_ptr<spdlog::logger> logger = nullptr,
+        bool use_acquisition_thread = false)
+        : o80Driver<MAX_SUBJECTS, &internal::reject_subject_name>(
+              receiver, origin_subject_name, logger, use_acquisition_thread),
+          subject_names_(subject_names)
+    {
+        if (subject_names.size() > MAX_SUBJECTS)
+        {
+            throw std::invalid_argument(
+                fmt::format("Got {} subject names but capacity is only {}.",
+                            subject_names.size(),
+                            MAX_SUBJECTS));
+        }
+        for (size_t i = 0; i < subject_names.size(); i++)
+        {
+            if (subject_names[i].empty())
+            {
+                throw std::invalid_argument("Subject names must not be empty.");
+            }
+            if (!indices_.emplace(subject_names[i], i).second)
+            {
+                throw std::invalid_argument(fmt::format(
+                    "Subject name '{}' is not unique.", subject_names[i]));
+            }
+        }
+    }
+
+    ~o80RuntimeSubjectsDriver()
+    {
+        // make sure the acquisition thread does not access indices_ anymore
+        // when it is destroyed
+        this->stop();
+    }
+
+    //! Names of the subjects, ordered by their index in the frame.
+    const std::vector<std::string>& get_subject_names() const
+    {
+        return subject_names_;
+    }
+
+protected:
+    size_t map_subject_name(const std::string& name) const override
+    {
+        auto it = indices_.find(name);
+        if (it == indices_.end())
+        {
+            throw UnknownSubjectError(name);
+        }
+        return it->second;
     }
 
 private:
-    ViconTransformer vicon_transformer_;
-    std::shared_ptr<spdlog::logger> log_;
+    std::vector<std::string> subject_names_;
+    std::unordered_map<std::string, size_t> indices_;
 };
 
 }  // namespace vicon_transformer
@@ -7,14 +7,20 @@
  */
 #pragma once
 
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 #include <o80/standalone.hpp>
 #include <o80/void_state.hpp>
+#include <shared_memory/shared_memory.hpp>
 
 #include "o80_driver.hpp"
 #include "types.hpp"
 
 namespace vicon_transformer
 {
+//! Default size of the o80 command/observation queue of the standalone.
 constexpr int STANDALONE_QUEUE_SIZE = 50000;
 //! Number of actuators (zero, as the Vicon system does not have actuation).
 constexpr int STANDALONE_N_ACTUATORS = 0;
@@ -28,17 +34,22 @@ constexpr int STANDALONE_N_ACTUATORS = 0;
  * All data provided by Vicon is written to the extended state.
  *
  * @tparam Driver An actual implementation of @ref o80Driver.
+ * @tparam QUEUE_SIZE Size of the o80 queues in shared memory.  Since each
+ *      observation contains a full frame, the shared memory needed by the
+ *      standalone grows with QUEUE_SIZE times the number of subjects.  Use a
+ *      smaller value to reduce the memory footprint if clients do not need a
+ *      long history.
  */
-template <typename Driver>
+template <typename Driver, int QUEUE_SIZE = STANDALONE_QUEUE_SIZE>
 class o80Standalone
-    : public o80::Standalone<STANDALONE_QUEUE_SIZE,
+    : public o80::Standalone<QUEUE_SIZE,
                              STANDALONE_N_ACTUATORS,
                              Driver,
                              o80::VoidState,               // State
                              typename Driver::DRIVER_OUT>  // ExtendedState
 {
 public:
-    using o80::Standalone<STANDALONE_QUEUE_SIZE,
+    using o80::Standalone<QUEUE_SIZE,
                           STANDALONE_N_ACTUATORS,
                           Driver,
                           o80::VoidState,
@@ -64,4 +75,71 @@ public:
     }
 };
 
+/**
+ * @brief Get the shared memory segment in which subject names are published.
+ *
+ * A separate segment is used, as o80 clears the segment of the standalone when
+ * starting it.
+ */
+inline std::string get_o80_subject_names_segment(const std::string& segment_id)
+{
+    return segment_id + "_subject_names";
+}
+
+/**
+ * @brief Publish the subject names of an o80 standalone in shared memory.
+ *
+ * Meant to be used together with @ref o80RuntimeSubjectsDriver, so that
+ * clients can find out which subject is at which index of the frame (see
+ * @ref read_o80_subject_names()).  Call this once when starting the standalone.
+ *
+ * @param segment_id Segment ID of the o80 standalone.
+ * @param subject_names Subject names, ordered by their index in the frame.
+ */
+inline void publish_o80_subject_names(
+    const std::string& segment_id,
+    const std::vector<std::string>& subject_names)
+{
+    // names cannot contain line breaks, so simply store them line by line
+    std::string table;
+    for (const std::string& name : subject_names)
+    {
+        if (name.find('\n') != std::string::npos)
+        {
+            throw std::invalid_argument(
+                "Subject names must not contain line breaks.");
+        }
+        table += name;
+        table += '\n';
+    }
+
+    const std::string segment = get_o80_subject_names_segment(segment_id);
+    shared_memory::clear_shared_memory(segment);
+    shared_memory::set(segment, "subject_names", table);
+}
+
+/**
+ * @brief Read the subject names published by @ref publish_o80_subject_names().
+ *
+ * @param segment_id Segment ID of the o80 standalone.
+ * @return Subject names, ordered by their index in the frame.
+ */
+inline std::vector<std::string> read_o80_subject_names(
+    const std::string& segment_id)
+{
+    std::string table;
+    shared_memory::get(
+        get_o80_subject_names_segment(segment_id), "subject_names", table);
+
+    std::vector<std::string> subject_names;
+    size_t begin = 0;
+    size_t end;
+    while ((end = table.find('\n', begin)) != std::string::npos)
+    {
+        subject_names.push_back(table.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return subject_names;
+}
+
 }  // namespace vicon_transformer
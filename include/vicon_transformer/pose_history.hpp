@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief History of subject poses with interpolation.
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <spatial_transformation/transformation.hpp>
+
+#include "types.hpp"
+
+namespace vicon_transformer
+{
+/**
+ * @brief Bounded history of frames that allows to get subject poses at
+ * arbitrary points in time.
+ *
+ * Frames are stored in a ring buffer of fixed capacity, so once the buffer is
+ * full, the oldest frame is overwritten when a new one is added.  Since the
+ * storage of overwritten frames is reused, no memory is allocated once the
+ * buffer is filled (as long as the number of subjects does not change).
+ *
+ * Poses between two frames are interpolated (linearly for the translation,
+ * using slerp for the rotation).
+ */
+class PoseHistory
+{
+public:
+    /**
+     * @param capacity Maximum number of frames that are stored.  If zero, no
+     *      frames are stored at all.
+     */
+    explicit PoseHistory(size_t capacity = 0);
+
+    //! Maximum number of frames that are stored.
+    size_t capacity() const
+    {
+        return buffer_.size();
+    }
+
+    //! Number of frames that are currently stored.
+    size_t size() const
+    {
+        return size_;
+    }
+
+    //! Change the capacity.  This clears the history.
+    void set_capacity(size_t capacity);
+
+    //! Remove all frames from the history.
+    void clear();
+
+    /**
+     * @brief Get the storage for a new frame that is added to the history.
+     *
+     * The returned frame is the newest entry of the history afterwards.  Its
+     * content is undefined (it may contain an old frame), so the caller has to
+     * overwrite it completely.  The time stamp of the frame has to be greater
+     * than the one of the previous frame, otherwise the history is corrupted
+     * (use @ref add() if this is not guaranteed).
+     *
+     * Must not be called if the capacity is zero.
+     */
+    FlatViconFrame& push();
+
+    /**
+     * @brief Add a frame to the history.
+     *
+     * If the frame is not newer than the newest frame in the history (e.g.
+     * because playback of a recording was restarted), the history is cleared
+     * before adding it.  Does nothing if the capacity is zero.
+     */
+    void add(const FlatViconFrame& frame);
+
+    //! Time stamp of the oldest frame in the history (undefined if empty).
+    int64_t oldest_time_stamp() const;
+
+    //! Time stamp of the newest frame in the history (undefined if empty).
+    int64_t newest_time_stamp() const;
+
+    /**
+     * @brief Get the pose of a subject at the given time.
+     *
+     * @param subject_name Name of the subject.
+     * @param time_stamp_ns Time stamp in nanoseconds.
+     * @return The pose, interpolated between the frames directly before and
+     *      after the given time.  std::nullopt if the time is not covered by
+     *      the history or if the subject is not visible in one of these two
+     *      frames.
+     */
+    std::optional<spatial_transformation::Transformation> get_pose_at(
+        const std::string& subject_name, int64_t time_stamp_ns) const noexcept;
+
+    /**
+     * @brief Like the name-based version but identifies the subject by index.
+     *
+     * For frames that share the given name table, the subject is accessed by
+     * index, in others it is looked up by name.
+     *
+     * @param names Name table in which the index is valid.
+     * @param index Index of the subject in names.
+     * @param time_stamp_ns Time stamp in nanoseconds.
+     */
+    std::optional<spatial_transformation::Transformation> get_pose_at(
+        const FlatViconFrame::NameTable& names,
+        size_t index,
+        int64_t time_stamp_ns) const noexcept;
+
+private:
+    std::vector<FlatViconFrame> buffer_;
+    //! Index of the oldest frame in buffer_.
+    size_t begin_ = 0;
+    size_t size_ = 0;
+
+    //! Get the i-th oldest frame.
+    const FlatViconFrame& at(size_t i) const
+    {
+        return buffer_[(begin_ + i) % buffer_.size()];
+    }
+
+    //! Implementation of get_pose_at().  names may be null.
+    std::optional<spatial_transformation::Transformation> get_pose_at(
+        const std::string& subject_name,
+        const FlatViconFrame::NameTable* names,
+        size_t index,
+        int64_t time_stamp_ns) const noexcept;
+
+    /**
+     * @brief Get data of the subject in the given frame.
+     *
+     * Uses index if the frame has the name table names, otherwise looks up the
+     * subject by name.
+     *
+     * @return Pointer to the data or nullptr if the subject is not in frame.
+     */
+    static const SubjectData* find_subject(
+        const FlatViconFrame& frame,
+        const std::string& subject_name,
+        const FlatViconFrame::NameTable* names,
+        size_t index) noexcept;
+};
+
+}  // namespace vicon_transformer
@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Helper functions for creating Python bindings of fixed-size frames.
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "types.hpp"
+
+namespace vicon_transformer
+{
+//! Check if a numpy dtype is registered for T (by any module).
+template <typename T>
+bool is_numpy_dtype_registered()
+{
+    return pybind11::detail::get_numpy_internals().get_type_info(typeid(T),
+                                                                 false);
+}
+
+/**
+ * @brief Register the numpy dtype of PackedSubjectData.
+ *
+ * Does nothing if it is already registered, so it is safe to call this
+ * multiple times.
+ */
+inline void register_packed_subject_dtype()
+{
+    if (is_numpy_dtype_registered<PackedSubjectData>())
+    {
+        return;
+    }
+    PYBIND11_NUMPY_DTYPE(
+        PackedSubjectData, translation, rotation, quality, is_visible);
+}
+
+/**
+ * @brief Convert a list of frames to a numpy array of PackedViconFrame.
+ *
+ * @tparam Frame Either FixedSizeViconFrame<NUM_SUBJECTS> or an o80
+ *      observation with FixedSizeViconFrame<NUM_SUBJECTS> as extended state
+ *      (e.g. the result of o80::FrontEnd::get_history_since()).
+ */
+template <size_t NUM_SUBJECTS, typename Frame>
+pybind11::array_t<PackedViconFrame<NUM_SUBJECTS>> to_packed_array(
+    const std::vector<Frame>& frames)
+{
+    pybind11::array_t<PackedViconFrame<NUM_SUBJECTS>> array(
+        static_cast<pybind11::ssize_t>(frames.size()));
+    PackedViconFrame<NUM_SUBJECTS>* data = array.mutable_data();
+    {
+        pybind11::gil_scoped_release release;
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            if constexpr (std::is_same_v<Frame,
+                                         FixedSizeViconFrame<NUM_SUBJECTS>>)
+            {
+                data[i] = PackedViconFrame<NUM_SUBJECTS>(frames[i]);
+            }
+            else
+            {
+                data[i] = PackedViconFrame<NUM_SUBJECTS>(
+                    frames[i].get_extended_state());
+            }
+        }
+    }
+    return array;
+}
+
+/**
+ * @brief Add bindings for PackedViconFrame<NUM_SUBJECTS>.
+ *
+ * Registers the numpy dtype of the packed frame (unless it is already
+ * registered, e.g. by the vicon_transformer module itself) and adds
+ *
+ * - a class ``PackedViconFrame<NUM_SUBJECTS>`` which supports the buffer
+ *   protocol (i.e. ``numpy.asarray(frame)`` gives a structured scalar array
+ *   without copying), and
+ * - a function ``to_packed_array(frames)`` that converts a list of
+ *   FixedSizeViconFrame<NUM_SUBJECTS> to a structured numpy array.
+ *
+ * Bindings for FixedSizeViconFrame<NUM_SUBJECTS> itself are not added here,
+ * as they are usually provided together with the o80 frontend.
+ */
+template <size_t NUM_SUBJECTS>
+void add_packed_frame_bindings(pybind11::module& m)
+{
+    namespace py = pybind11;
+    using Packed = PackedViconFrame<NUM_SUBJECTS>;
+
+    register_packed_subject_dtype();
+    if (is_numpy_dtype_registered<Packed>())
+    {
+        // dtype and class are already provided by another module
+        return;
+    }
+    PYBIND11_NUMPY_DTYPE(Packed,
+                         time_stamp,
+                         frame_number,
+                         num_subjects,
+                         frame_rate,
+                         latency,
+                         age_ns,
+                         frames_missed,
+                         subjects);
+
+    const std::string name =
+        "PackedViconFrame" + std::to_string(NUM_SUBJECTS);
+    py::class_<Packed>(m, name.c_str(), py::buffer_protocol())
+        .def(py::init<>())
+        .def(py::init<const FixedSizeViconFrame<NUM_SUBJECTS>&>(),
+             py::arg("frame"))
+        .def("unpack", &Packed::unpack)
+        .def_readonly("time_stamp", &Packed::time_stamp)
+        .def_readonly("frame_number", &Packed::frame_number)
+        .def_readonly("frame_rate", &Packed::frame_rate)
+        .def_readonly("latency", &Packed::latency)
+        .def_readonly("age_ns", &Packed::age_ns)
+        .def_readonly("frames_missed", &Packed::frames_missed)
+        .def_buffer(
+            [](Packed& frame)
+            {
+                // zero-dimensional buffer with the whole frame as one item
+                return py::buffer_info(&frame,
+                                       sizeof(Packed),
+                                       py::format_descriptor<Packed>::format(),
+                                       0,
+                                       {},
+                                       {});
+            });
+
+    m.def("to_packed_array",
+          &to_packed_array<NUM_SUBJECTS, FixedSizeViconFrame<NUM_SUBJECTS>>,
+          py::arg("frames"),
+          "Convert a list of FixedSizeViconFrame to a numpy structured array.");
+}
+
+/**
+ * @brief Add functions to get the history of an o80 frontend as packed array.
+ *
+ * Adds the functions
+ *
+ * - ``get_packed_history_since(frontend, iteration)`` and
+ * - ``get_packed_latest(frontend, nb_items)``,
+ *
+ * which call the corresponding methods of the frontend and directly convert
+ * the observations to a numpy array of PackedViconFrame, without creating a
+ * Python object per observation.  They are overloads, so this can be called
+ * for several frontend types.
+ *
+ * The Python class of the frontend needs to be bound separately (usually by
+ * the code that defines the o80 driver).
+ *
+ * @tparam FrontEnd o80::FrontEnd with FixedSizeViconFrame as extended state.
+ */
+template <typename FrontEnd>
+void add_packed_frontend_bindings(pybind11::module& m)
+{
+    namespace py = pybind11;
+    using Observation = typename decltype(std::declval<FrontEnd&>().get_latest(
+        1))::value_type;
+    using Frame = std::decay_t<decltype(std::declval<const Observation&>()
+                                            .get_extended_state())>;
+    constexpr size_t NUM_SUBJECTS = Frame::max_num_subjects;
+
+    add_packed_frame_bindings<NUM_SUBJECTS>(m);
+
+    m.def(
+        "get_packed_history_since",
+        [](FrontEnd& frontend, long int iteration)
+        {
+            std::vector<Observation> history;
+            {
+                py::gil_scoped_release release;
+                history = frontend.get_history_since(iteration);
+            }
+            return to_packed_array<NUM_SUBJECTS>(history);
+        },
+        py::arg("frontend"),
+        py::arg("iteration"),
+        "Get all observations since the given iteration as numpy structured "
+        "array of PackedViconFrame.");
+    m.def(
+        "get_packed_latest",
+        [](FrontEnd& frontend, size_t nb_items)
+        {
+            std::vector<Observation> history;
+            {
+                py::gil_scoped_release release;
+                history = frontend.get_latest(nb_items);
+            }
+            return to_packed_array<NUM_SUBJECTS>(history);
+        },
+        py::arg("frontend"),
+        py::arg("nb_items"),
+        "Get the latest observations as numpy structured array of "
+        "PackedViconFrame.");
+}
+
+}  // namespace vicon_transformer
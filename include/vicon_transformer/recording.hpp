@@ -0,0 +1,481 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Streaming file format for recordings of Vicon frames.
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "frame_codec.hpp"
+#include "types.hpp"
+
+namespace vicon_transformer
+{
+/**
+ * @brief Entry of the chunk index of a recording file.
+ *
+ * See @ref RecordingWriter for a description of the file format.
+ */
+struct RecordingChunkInfo
+{
+    //! Offset of the chunk (i.e. its header) from the beginning of the file.
+    uint64_t offset = 0;
+    //! Number of frames in the chunk.
+    uint32_t num_frames = 0;
+    //! Frame number of the first frame in the chunk.
+    int32_t first_frame_number = 0;
+    //! Frame number of the last frame in the chunk.
+    int32_t last_frame_number = 0;
+    //! Time stamp of the first frame in the chunk.
+    int64_t first_time_stamp = 0;
+    //! Time stamp of the last frame in the chunk.
+    int64_t last_time_stamp = 0;
+};
+
+/**
+ * @brief Check if the given file is a recording in the format written by
+ * @ref RecordingWriter (based on the magic bytes at the start of the file).
+ */
+bool is_recording_file(const std::filesystem::path& filename);
+
+/**
+ * @brief Write Vicon frames to a file while they are recorded.
+ *
+ * Other than serialising a whole std::vector<ViconFrame> at the end, the
+ * frames are written incrementally, so the memory usage is constant, no matter
+ * how long the recording is.
+ *
+ * Frames are collected in chunks.  Once a chunk is full, it is passed to a
+ * background thread that writes it to the file, while new frames are collected
+ * in a second buffer.  So @ref write() does not block on disk I/O unless the
+ * disk is slower than the rate at which frames are written.
+ *
+ * File format (all integers are stored in little-endian byte order):
+ *
+ * - Header: magic bytes "VICONREC", format version (uint32), frames per chunk
+ *   (uint32), quantisation step and rotation quantisation step (double each,
+ *   see FrameEncoder).
+ * - Chunks, each consisting of a header with magic bytes "CHNK", the number of
+ *   frames (uint32), the payload size in bytes (uint64) and the CRC-32 of the
+ *   payload (uint32), followed by the payload.  The payload is a sequence of
+ *   frames, each encoded with FrameEncoder relative to the previous frame of
+ *   the chunk and prefixed by a header consisting of the size of the encoded
+ *   frame, the difference of the frame number and the difference of the time
+ *   stamp to the previous frame (all variable-length integers, differences
+ *   zigzag-encoded).  The first frame of each chunk is encoded without
+ *   reference to a previous frame, so chunks can be decoded independently.
+ * - Index: magic bytes "INDX", number of chunks (uint64) and one
+ *   RecordingChunkInfo per chunk (offset: uint64, num_frames: uint32,
+ *   first/last frame number: int32, first/last time stamp: int64).
+ * - Footer: offset of the index (uint64) and magic bytes "VRECEND\0".
+ *
+ * Each chunk is flushed to the file as soon as it is complete.  If the writer
+ * is not closed properly (e.g. because the process is killed), index and
+ * footer are missing but the chunks that have been written so far can still be
+ * read (see RecordingReader and recover_recording()).  The checksum allows to
+ * detect chunks that have been written incompletely or got corrupted.
+ */
+class RecordingWriter
+{
+public:
+    //! Current version of the file format.
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    //! Encoded frames of one chunk.
+    struct EncodedChunk
+    {
+        std::vector<char> data;
+        RecordingChunkInfo info;
+    };
+
+    /**
+     * @param filename Path to the output file.  Existing files are
+     *      overwritten.
+     * @param frames_per_chunk Number of frames that are collected before
+     *      writing them to the file.
+     * @param quantization_step If zero, translations are stored losslessly.
+     *      Otherwise they are rounded to multiples of this value (in metres),
+     *      which reduces the file size considerably (see FrameEncoder).
+     *      Lossless recordings are only about 2.3 times smaller than with
+     *      cereal serialisation, with 1e-6 (as used by ``vicon_record
+     *      --quantize``) about 7.
+     * @param rotation_quantization_step Like quantization_step but for the
+     *      components of the rotation quaternions (``vicon_record --quantize``
+     *      uses 1e-7).
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    RecordingWriter(const std::filesystem::path& filename,
+                    uint32_t frames_per_chunk = 300,
+                    double quantization_step = 0.0,
+                    double rotation_quantization_step = 0.0);
+
+    /**
+     * @brief Closes the file (see @ref close()) if not already done.
+     *
+     * Note that this writes the index, so call @ref abort() first if the
+     * recording is incomplete.
+     */
+    ~RecordingWriter();
+
+    RecordingWriter(const RecordingWriter&) = delete;
+    RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+    /**
+     * @brief Add a frame to the recording.
+     *
+     * The frame is serialised to the current chunk.  If the chunk is full, it
+     * is handed over to the writer thread.
+     *
+     * @throws std::runtime_error if writing a previous chunk failed.
+     */
+    void write(const ViconFrame& frame);
+
+    /**
+     * @brief Write all remaining frames and the index and close the file.
+     *
+     * @throws std::runtime_error if writing failed.
+     */
+    void close();
+
+    /**
+     * @brief Stop writing and close the file without writing the index.
+     *
+     * Use this if writing the recording cannot be completed (e.g. because the
+     * input of a conversion is corrupted), so the result is not mistaken for a
+     * complete recording.  Like a recording of a killed process, the file
+     * has no index then.  Does nothing if the writer is already closed.
+     */
+    void abort() noexcept;
+
+    /**
+     * @brief Encode frames to a chunk that can be passed to @ref write_chunk().
+     *
+     * This does not depend on the state of a writer, so multiple chunks can be
+     * encoded in parallel.
+     *
+     * @param frames Frames of the chunk.
+     * @param quantization_step Has to match the one of the writer to which
+     *      the chunk is passed.
+     * @param rotation_quantization_step Has to match the one of the writer.
+     */
+    static EncodedChunk encode_chunk(const std::vector<ViconFrame>& frames,
+                                     double quantization_step,
+                                     double rotation_quantization_step);
+
+    /**
+     * @brief Add a chunk that was encoded with @ref encode_chunk().
+     *
+     * If there are frames added with @ref write() that are not yet written,
+     * they are written first (as a smaller chunk), so the order of frames is
+     * kept.
+     *
+     * @throws std::runtime_error if writing a previous chunk failed.
+     */
+    void write_chunk(EncodedChunk&& chunk);
+
+    //! Number of frames that have been passed to @ref write().
+    size_t num_frames() const
+    {
+        return num_frames_;
+    }
+
+private:
+    std::ofstream file_;
+    uint32_t frames_per_chunk_;
+    double quantization_step_;
+    double rotation_quantization_step_;
+    size_t num_frames_ = 0;
+    bool closed_ = false;
+
+    //! Chunk to which new frames are added (owned by the caller's thread).
+    EncodedChunk active_;
+    FrameEncoder encoder_;
+    //! Encoded frame (reused to avoid allocations).
+    std::vector<char> frame_buffer_;
+    //! Chunk that is handed over to the writer thread.
+    EncodedChunk pending_;
+    bool has_pending_ = false;
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::exception_ptr write_error_;
+    std::thread writer_thread_;
+
+    //! Index of all chunks written so far (only accessed by writer thread).
+    std::vector<RecordingChunkInfo> index_;
+
+    //! Pass the active chunk to the writer thread.
+    void submit_active_chunk();
+
+    //! Loop of the writer thread.
+    void writer_loop();
+
+    //! Write a chunk to the file.
+    void write_chunk_to_file(const EncodedChunk& chunk);
+
+    //! Encode a frame and append it to chunk.
+    static void append_frame(const ViconFrame& frame,
+                             FrameEncoder& encoder,
+                             std::vector<char>& frame_buffer,
+                             EncodedChunk& chunk);
+
+    //! Write index and footer.
+    void write_index();
+
+    //! Throw if the writer thread reported an error.
+    void check_write_error();
+};
+
+/**
+ * @brief Read recordings in the format written by @ref RecordingWriter.
+ *
+ * The file is memory-mapped and frames are only decoded when they are
+ * requested.  So opening a recording is fast, independent of its length, and
+ * only the parts of the file that are actually accessed are loaded into
+ * memory.
+ */
+class RecordingReader
+{
+public:
+    /**
+     * @param filename Path to the recording.
+     * @throws std::runtime_error if the file cannot be opened or is not a valid
+     *      recording.
+     */
+    explicit RecordingReader(const std::filesystem::path& filename);
+
+    ~RecordingReader();
+
+    RecordingReader(const RecordingReader&) = delete;
+    RecordingReader& operator=(const RecordingReader&) = delete;
+
+    //! Index of all chunks in the file.
+    const std::vector<RecordingChunkInfo>& chunks() const
+    {
+        return chunks_;
+    }
+
+    //! Total number of frames in the recording.
+    size_t num_frames() const
+    {
+        return num_frames_;
+    }
+
+    /**
+     * @brief Check if the file was closed properly.
+     *
+     * If false, the file has no index (e.g. because the recording process was
+     * killed) and the index was reconstructed by scanning the chunks.  Chunks
+     * that are incomplete or have an invalid checksum are skipped in this
+     * case.
+     */
+    bool has_index() const
+    {
+        return has_index_;
+    }
+
+    //! Number of frames per chunk with which the file was written.
+    uint32_t frames_per_chunk() const
+    {
+        return frames_per_chunk_;
+    }
+
+    //! Quantisation step with which the frames were encoded (0 if lossless).
+    double quantization_step() const
+    {
+        return quantization_step_;
+    }
+
+    //! Quantisation step of the rotations (0 if lossless).
+    double rotation_quantization_step() const
+    {
+        return rotation_quantization_step_;
+    }
+
+    /**
+     * @brief Decode a single frame.
+     *
+     * Reading frames sequentially is most efficient, as frames are encoded
+     * relative to their predecessor.  For random access, all frames from the
+     * start of the chunk up to the requested frame need to be decoded.
+     *
+     * @param frame_index Index of the frame in the recording.
+     * @param frame The decoded frame is written to this.
+     * @throws std::out_of_range if frame_index is not less than @ref
+     *      num_frames().
+     * @throws std::runtime_error if the chunk of the frame is corrupted.
+     */
+    void read_frame(size_t frame_index, ViconFrame& frame);
+
+    /**
+     * @brief Read all frames of a chunk.
+     *
+     * @param chunk_index Index of the chunk (see @ref chunks()).
+     * @param frames Vector to which the frames are appended.
+     */
+    void read_chunk(size_t chunk_index, std::vector<ViconFrame>& frames);
+
+    //! Read all frames of the recording.
+    std::vector<ViconFrame> read_all();
+
+    /**
+     * @brief Like @ref read_chunk() but thread-safe.
+     *
+     * This does not use the cached state of @ref read_frame() and can
+     * therefore be called from multiple threads in parallel (e.g. to decode
+     * different chunks).
+     *
+     * @throws std::out_of_range if chunk_index is invalid.
+     * @throws std::runtime_error if the chunk is corrupted.
+     */
+    void decode_chunk(size_t chunk_index,
+                      std::vector<ViconFrame>& frames) const;
+
+    /**
+     * @brief Find the first frame with a frame number not less than the given
+     * one.
+     *
+     * Uses binary search on the chunk index and the frame headers of one
+     * chunk, so the complexity is logarithmic in the length of the recording.
+     * Assumes frame numbers are increasing (which is the case for recordings
+     * of a Vicon system).
+     *
+     * @return Index of the frame or @ref num_frames() if there is no such
+     *      frame.
+     */
+    size_t find_frame_number(int frame_number);
+
+    /**
+     * @brief Find the first frame with a time stamp not less than the given
+     * one.
+     *
+     * Like @ref find_frame_number(), this is done in logarithmic time.
+     *
+     * @return Index of the frame or @ref num_frames() if there is no such
+     *      frame.
+     */
+    size_t find_time_stamp(int64_t time_stamp_ns);
+
+private:
+    //! Location and header of a serialised frame.
+    struct FrameRef
+    {
+        const char* data = nullptr;
+        size_t size = 0;
+        int32_t frame_number = 0;
+        int64_t time_stamp = 0;
+    };
+    using FrameList = std::vector<FrameRef>;
+
+    static constexpr size_t NO_CHUNK = static_cast<size_t>(-1);
+    static constexpr size_t NO_FRAME = static_cast<size_t>(-1);
+
+    //! Memory-mapped file content.
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    std::vector<RecordingChunkInfo> chunks_;
+    //! Index of the first frame of each chunk.
+    std::vector<size_t> chunk_first_frame_;
+    size_t num_frames_ = 0;
+    bool has_index_ = false;
+    uint32_t frames_per_chunk_ = 0;
+    double quantization_step_ = 0.0;
+    double rotation_quantization_step_ = 0.0;
+
+    //! Index of the chunk of which the frames are in chunk_frames_.
+    size_t loaded_chunk_ = NO_CHUNK;
+    FrameList chunk_frames_;
+    FrameDecoder decoder_;
+    //! Index (within the loaded chunk) of the frame last passed to decoder_.
+    size_t decoded_frame_ = NO_FRAME;
+
+    //! Make chunk_frames_ refer to the frames of the given chunk.
+    void load_chunk(size_t chunk_index);
+
+    /**
+     * @brief Get the frames of the chunk at the given file offset.
+     *
+     * @return False if there is no complete, valid chunk at offset.
+     */
+    bool parse_chunk(uint64_t offset, FrameList& frames) const;
+
+    //! Try to read the index at the end of the file.
+    bool read_index();
+
+    //! Reconstruct the index by iterating over all complete chunks.
+    void scan_chunks();
+
+    //! Index of the first frame for which frame_value is not less than value.
+    template <typename T>
+    size_t lower_bound(T RecordingChunkInfo::*chunk_last,
+                       T FrameRef::*frame_value,
+                       T value);
+};
+
+/**
+ * @brief Convert a recording to the current format of @ref RecordingWriter.
+ *
+ * The input can be either a serialised std::vector<ViconFrame> (as written by
+ * older versions of vicon_record, including frames of format version 3) or a
+ * recording of the current format (e.g. to change the quantisation).  Pickle
+ * files of the old Python receiver are not supported.
+ *
+ * Frames are read one by one, so this works for files that are larger than
+ * the available memory.  Encoding (and for recordings of the current format
+ * also decoding) of chunks is distributed over multiple threads.
+ *
+ * @param input_file Path to the old recording.
+ * @param output_file Path to which the converted recording is written.
+ * @param frames_per_chunk See @ref RecordingWriter.  Only used for old-style
+ *      input files, otherwise the chunks of the input file are kept.
+ * @param quantization_step See @ref RecordingWriter.
+ * @param rotation_quantization_step See @ref RecordingWriter.
+ * @param num_threads Number of chunks that are processed in parallel.  If
+ *      zero, the number of CPU cores is used.
+ * @throws std::runtime_error if the input cannot be read.  The output file is
+ *      deleted in this case.
+ */
+void convert_to_recording(const std::filesystem::path& input_file,
+                          const std::filesystem::path& output_file,
+                          uint32_t frames_per_chunk = 300,
+                          double quantization_step = 0.0,
+                          double rotation_quantization_step = 0.0,
+                          unsigned int num_threads = 0);
+
+//! Result of @ref recover_recording().
+struct RecoveryResult
+{
+    //! Number of frames written to the recovered file.
+    size_t num_frames = 0;
+    //! Number of chunks that were skipped because they are corrupted.
+    size_t num_corrupted_chunks = 0;
+    //! Whether the input file was closed properly (i.e. has an index).
+    bool had_index = false;
+};
+
+/**
+ * @brief Salvage all valid chunks of a damaged recording.
+ *
+ * Writes all frames of chunks that are complete and have a valid checksum to
+ * a new, properly closed recording.  This is meant for files of recordings
+ * that were aborted (e.g. because the process was killed) or got corrupted.
+ *
+ * @param input_file Path to the damaged recording.
+ * @param output_file Path to which the recovered recording is written.
+ * @throws std::runtime_error if the input is not a recording at all.
+ */
+RecoveryResult recover_recording(const std::filesystem::path& input_file,
+                                 const std::filesystem::path& output_file);
+
+}  // namespace vicon_transformer
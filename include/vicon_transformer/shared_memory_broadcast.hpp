@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Broadcast Vicon frames to other processes via shared memory.
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#pragma once
+
+#include <sys/types.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame_codec.hpp"
+#include "types.hpp"
+#include "vicon_receiver.hpp"
+
+namespace vicon_transformer
+{
+/**
+ * @brief Publish Vicon frames in a POSIX shared memory ring buffer.
+ *
+ * Meant for providing the frames of a single @ref ViconReceiver to several
+ * local processes (e.g. controller, logger and visualisation), which read them
+ * with @ref SharedMemoryReceiver, so that only one connection to the Vicon
+ * server is needed.
+ *
+ * The shared memory contains a ring buffer of ``num_slots`` slots.  Each frame
+ * is written to the next slot, overwriting the oldest frame.  Slots are
+ * protected by a sequence counter (seqlock): readers detect if a slot was
+ * overwritten while they were reading it and simply retry.  Readers only map
+ * the memory read-only, so they cannot block or otherwise affect the
+ * publisher, no matter if they attach, detach or lag behind.
+ *
+ * Frames are stored with @ref FrameEncoder (lossless), each encoded on its own
+ * so it can be decoded without the previous frames.
+ *
+ * There can only be one publisher per name: creating a publisher fails if the
+ * shared memory is still used by another running publisher, unless it is
+ * explicitly taken over.  When
+ * destroyed, the publisher marks the buffer as closed and removes the shared
+ * memory object (readers that are still attached keep their mapping until
+ * they detach).
+ */
+class SharedMemoryPublisher
+{
+public:
+    static constexpr uint32_t DEFAULT_NUM_SLOTS = 64;
+    static constexpr uint32_t DEFAULT_MAX_FRAME_SIZE = 16384;
+
+    /**
+     * @param name Name of the shared memory object (a leading "/" is added if
+     *      missing).
+     * @param num_slots Number of frames kept in the ring buffer.  Readers can
+     *      lag behind by up to this number of frames without losing frames.
+     * @param max_frame_size Maximum size of an encoded frame in bytes.
+     * @param take_over If true, replace an existing shared memory object with
+     *      the same name, even if it may still be used by another publisher.
+     *      If false, it is only replaced if its publisher was closed or its
+     *      process is not running anymore.
+     *
+     * @throws std::invalid_argument if num_slots or max_frame_size is zero.
+     * @throws std::runtime_error if the shared memory cannot be created or is
+     *      used by another publisher (and take_over is false).
+     */
+    explicit SharedMemoryPublisher(
+        const std::string& name,
+        uint32_t num_slots = DEFAULT_NUM_SLOTS,
+        uint32_t max_frame_size = DEFAULT_MAX_FRAME_SIZE,
+        bool take_over = false);
+
+    ~SharedMemoryPublisher();
+
+    SharedMemoryPublisher(const SharedMemoryPublisher&) = delete;
+    SharedMemoryPublisher& operator=(const SharedMemoryPublisher&) = delete;
+
+    /**
+     * @brief Write a frame to the ring buffer.
+     *
+     * Never waits for readers.
+     *
+     * @throws std::length_error if the encoded frame is larger than
+     *      max_frame_size.
+     */
+    void publish(const ViconFrame& frame);
+
+    //! Number of frames published so far.
+    uint64_t num_published_frames() const
+    {
+        return num_published_;
+    }
+
+private:
+    std::string shm_name_;
+    char* data_ = nullptr;
+    size_t size_ = 0;
+    //! Identifies the shared memory object, in case the name is taken over.
+    dev_t shm_device_ = 0;
+    ino_t shm_inode_ = 0;
+    uint32_t num_slots_;
+    uint32_t max_frame_size_;
+
+    FrameEncoder encoder_;
+    std::vector<char> buffer_;
+    uint64_t num_published_ = 0;
+};
+
+/**
+ * @brief Receive frames from a @ref SharedMemoryPublisher.
+ *
+ * Attaching to the shared memory does not require any action of the publisher
+ * and readers never write to it, so any number of receivers can be used at the
+ * same time.  Reading is non-blocking on the publisher's side: if the
+ * publisher overwrites a slot while it is read, the read is repeated with a
+ * newer frame.
+ *
+ * @ref read() blocks until a new frame is published.  To not block forever if
+ * the publisher crashed, it checks if the publisher process is still running
+ * (based on its process ID, so publisher and receivers need to be in the same
+ * PID namespace).
+ *
+ * By default, @ref read() returns the newest published frame, like @ref
+ * ViconReceiver.  With ``read_all_frames`` set, frames are returned in order
+ * instead, so no frames are skipped as long as the receiver does not lag behind
+ * by more than the size of the ring buffer.  In both cases, the number of
+ * skipped frames can be checked with @ref num_dropped_frames().
+ */
+class SharedMemoryReceiver : public Receiver
+{
+public:
+    //! Interval at which @ref read() checks for new frames while waiting.
+    static constexpr std::chrono::microseconds POLL_INTERVAL{100};
+
+    /**
+     * @param name Name of the shared memory object (same as used for the
+     *      publisher).
+     * @param read_all_frames If true, return frames in order instead of only
+     *      the newest one.
+     *
+     * @throws std::runtime_error if there is no publisher with that name or the
+     *      shared memory has an unexpected format.
+     */
+    explicit SharedMemoryReceiver(const std::string& name,
+                                  bool read_all_frames = false);
+
+    ~SharedMemoryReceiver();
+
+    SharedMemoryReceiver(const SharedMemoryReceiver&) = delete;
+    SharedMemoryReceiver& operator=(const SharedMemoryReceiver&) = delete;
+
+    /**
+     * @brief Get the next frame.  Block until a new frame is published.
+     *
+     * @throws std::runtime_error if the publisher was closed or is not running
+     *      anymore and there are no more frames to read.
+     */
+    ViconFrame read() override;
+
+    //! Like @ref read() but reuses the memory of the given frame.
+    void read_into(ViconFrame& frame) override;
+
+    /**
+     * @brief Get the next frame if one is available, without blocking.
+     *
+     * @return True if a frame was written to frame, false if no new frame was
+     *      published since the last read (frame is not modified in this case).
+     */
+    bool try_read_into(ViconFrame& frame);
+
+    //! Check if the publisher was closed.
+    bool is_publisher_closed() const;
+
+    /**
+     * @brief Check if the process of the publisher is still running.
+     *
+     * In contrast to @ref is_publisher_closed(), this also detects if the
+     * publisher crashed.
+     */
+    bool is_publisher_alive() const;
+
+    /**
+     * @brief Number of frames that were skipped since the first read.
+     *
+     * Frames are skipped if newer frames are available when reading (unless
+     * ``read_all_frames`` is set) or if they were overwritten before they
+     * were read.
+     */
+    uint64_t num_dropped_frames() const
+    {
+        return num_dropped_frames_;
+    }
+
+private:
+    std::string shm_name_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool read_all_frames_;
+
+    FrameDecoder decoder_;
+    std::vector<char> buffer_;
+    //! Index of the next frame to read.
+    uint64_t next_frame_ = 0;
+    bool has_read_ = false;
+    uint64_t num_dropped_frames_ = 0;
+
+    //! Copy frame with the given index from its slot (false if overwritten).
+    bool read_slot(uint64_t frame_index, ViconFrame& frame);
+};
+
+}  // namespace vicon_transformer
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Compile-time mapping between subject names and indices.
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "errors.hpp"
+
+namespace vicon_transformer
+{
+namespace internal
+{
+//! Get the indices of the given names, sorted by name.
+template <size_t N>
+constexpr std::array<size_t, N> sort_subject_indices(
+    const std::array<std::string_view, N>& names)
+{
+    std::array<size_t, N> indices{};
+    for (size_t i = 0; i < N; i++)
+    {
+        indices[i] = i;
+    }
+    // insertion sort, as std::sort is not constexpr in C++17
+    for (size_t i = 1; i < N; i++)
+    {
+        const size_t index = indices[i];
+        size_t j = i;
+        while (j > 0 && names[index] < names[indices[j - 1]])
+        {
+            indices[j] = indices[j - 1];
+            j--;
+        }
+        indices[j] = index;
+    }
+    return indices;
+}
+
+//! Check that all names are non-empty and unique.
+template <size_t N>
+constexpr bool has_unique_subject_names(
+    const std::array<std::string_view, N>& names)
+{
+    const std::array<size_t, N> indices = sort_subject_indices(names);
+    for (size_t i = 0; i < N; i++)
+    {
+        if (names[indices[i]].empty() ||
+            (i > 0 && names[indices[i]] == names[indices[i - 1]]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace internal
+
+/**
+ * @brief Mapping between subject names and indices, generated at compile time.
+ *
+ * The subjects are defined by a type that provides the names as a static
+ * constexpr array:
+ *
+ * @code
+ * struct MySubjects
+ * {
+ *     static constexpr std::array<std::string_view, 3> names = {
+ *         "rll_ping_base", "rll_muscle_base", "ball_launcher"};
+ * };
+ *
+ * using Registry = SubjectRegistry<MySubjects>;
+ * static_assert(Registry::index_of("rll_muscle_base") == 1);
+ * @endcode
+ *
+ * The index of a subject is its position in the list.  Name lookup uses binary
+ * search on a table that is sorted at compile time.  Duplicate or empty names
+ * are rejected at compile time.
+ *
+ * @tparam SubjectList Type with a static member ``names`` of type
+ *      ``std::array<std::string_view, N>``.
+ */
+template <typename SubjectList>
+class SubjectRegistry
+{
+public:
+    //! Number of subjects.
+    static constexpr size_t size = SubjectList::names.size();
+
+    //! Get the name of the subject with the given index.
+    static constexpr std::string_view name(size_t index)
+    {
+        return SubjectList::names[index];
+    }
+
+    //! All subject names, ordered by index.
+    static constexpr const std::array<std::string_view, size>& names()
+    {
+        return SubjectList::names;
+    }
+
+    /**
+     * @brief Get the index of the subject with the given name.
+     *
+     * @return Index of the subject or std::nullopt if there is no subject with
+     *      that name.
+     */
+    static constexpr std::optional<size_t> find(std::string_view subject_name)
+    {
+        // binary search in the sorted table
+        size_t first = 0;
+        size_t count = size;
+        while (count > 0)
+        {
+            const size_t step = count / 2;
+            const size_t mid = first + step;
+            if (name(sorted_indices_[mid]) < subject_name)
+            {
+                first = mid + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+        if (first < size && name(sorted_indices_[first]) == subject_name)
+        {
+            return sorted_indices_[first];
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Get the index of the subject with the given name.
+     *
+     * @throws UnknownSubjectError if there is no subject with that name.
+     */
+    static constexpr size_t index_of(std::string_view subject_name)
+    {
+        std::optional<size_t> index = find(subject_name);
+        if (!index)
+        {
+            throw UnknownSubjectError(std::string(subject_name));
+        }
+        return *index;
+    }
+
+    /**
+     * @brief Like @ref index_of() but with the signature expected by @ref
+     * o80Driver for ``map_name_to_index``.
+     */
+    static size_t map_name_to_index(const std::string& subject_name)
+    {
+        return index_of(subject_name);
+    }
+
+private:
+    static_assert(
+        internal::has_unique_subject_names(SubjectList::names),
+        "Subject names must be unique and must not be empty.");
+
+    //! Indices of the subjects, sorted by name.
+    static constexpr std::array<size_t, size> sorted_indices_ =
+        internal::sort_subject_indices(SubjectList::names);
+};
+
+}  // namespace vicon_transformer
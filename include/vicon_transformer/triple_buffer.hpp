@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Lock-free triple buffer for passing data between two threads.
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace vicon_transformer
+{
+/**
+ * @brief Lock-free single-producer/single-consumer "latest value" slot.
+ *
+ * Holds three instances of T: one owned by the writer, one owned by the reader
+ * and one in the middle that is exchanged atomically between the two.  The
+ * writer fills its buffer and publishes it, the reader swaps in the latest
+ * published buffer.  Neither side ever blocks or waits for the other and
+ * values that are published while the reader is busy are simply overwritten
+ * by newer ones.
+ *
+ * Buffers are reused in a round-robin fashion, so if T holds dynamically
+ * allocated memory (e.g. a std::map), the writer can update its buffer in place
+ * to avoid reallocating.
+ *
+ * Only one thread may use the writer methods and only one (other) thread may
+ * use the reader methods.
+ *
+ * @tparam T Type of the stored value.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer side
+
+    //! Buffer that can be filled by the writer before calling @ref publish().
+    T& write_buffer()
+    {
+        return buffers_[write_index_];
+    }
+
+    /**
+     * @brief Make the content of the write buffer available to the reader.
+     *
+     * Afterwards, @ref write_buffer() refers to a different buffer with
+     * unspecified (old) content.
+     */
+    void publish()
+    {
+        uint8_t previous = middle_.exchange(write_index_ | NEW_DATA_FLAG,
+                                            std::memory_order_acq_rel);
+        write_index_ = previous & INDEX_MASK;
+    }
+
+    // Reader side
+
+    //! Check if a value was published since the last call of @ref swap().
+    bool has_new_data() const
+    {
+        return middle_.load(std::memory_order_acquire) & NEW_DATA_FLAG;
+    }
+
+    /**
+     * @brief Make the latest published value available in @ref read_buffer().
+     *
+     * @return True if there was a new value, false if nothing was published
+     *      since the last call (in this case @ref read_buffer() is unchanged).
+     */
+    bool swap()
+    {
+        if (!has_new_data())
+        {
+            return false;
+        }
+
+        uint8_t previous =
+            middle_.exchange(read_index_, std::memory_order_acq_rel);
+        read_index_ = previous & INDEX_MASK;
+        return true;
+    }
+
+    //! Value that was obtained by the last call of @ref swap().
+    const T& read_buffer() const
+    {
+        return buffers_[read_index_];
+    }
+
+    //! Mutable access to the read buffer (e.g. to swap its content out).
+    T& read_buffer()
+    {
+        return buffers_[read_index_];
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0b011;
+    static constexpr uint8_t NEW_DATA_FLAG = 0b100;
+
+    std::array<T, 3> buffers_;
+    uint8_t write_index_ = 0;
+    uint8_t read_index_ = 1;
+    //! Index of the middle buffer, combined with NEW_DATA_FLAG.
+    std::atomic<uint8_t> middle_ = 2;
+};
+
+}  // namespace vicon_transformer
@@ -7,14 +7,25 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
 
+#include <Eigen/Core>
 #include <fmt/ostream.h>
 #include <cereal/cereal.hpp>
 #include <cereal/types/array.hpp>
 #include <cereal/types/map.hpp>
 #include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
 
 #include <spatial_transformation/transformation.hpp>
 
@@ -162,6 +173,183 @@ struct ViconFrame
     }
 };
 
+/**
+ * @brief Copy a frame, reusing the memory of the target frame.
+ *
+ * Other than a plain assignment, this guarantees that no memory is allocated
+ * if the target frame already contains the same set of subjects as the source
+ * frame (the subject entries are updated in place).
+ *
+ * @param source The frame that is copied.
+ * @param target The frame to which the data is written.
+ */
+void copy_frame(const ViconFrame& source, ViconFrame& target);
+
+/**
+ * @brief Alternative to ViconFrame with the subjects stored in a flat array.
+ *
+ * Subject data is stored in a contiguous array that can be accessed by index.
+ * The corresponding names are stored separately in an immutable name table,
+ * which is shared between all frames with the same set of subjects (so copying
+ * a frame does not copy the names).
+ *
+ * The names are sorted, so the subjects are in the same order as in
+ * ViconFrame::subjects.
+ */
+struct FlatViconFrame
+{
+    //! Sorted list of subject names.
+    using NameTable = std::vector<std::string>;
+
+    //! Frame sequence number.
+    int frame_number = 0;
+    //! Frame rate of the Vicon system.
+    double frame_rate = 0.0;
+    //! Latency of the frame.
+    double latency = 0.0;
+    //! Time stamp when the frame was acquired.
+    int64_t time_stamp = 0;
+
+    /**
+     * @brief Names of the subjects.
+     *
+     * ``subject_names->at(i)`` is the name of ``subjects[i]``.  Never null.
+     */
+    std::shared_ptr<const NameTable> subject_names = empty_name_table();
+
+    /**
+     * @brief List of subjects.
+     *
+     * Like in ViconFrame, this contains entries for all registered subjects,
+     * even if they are not visible in the current frame.
+     */
+    std::vector<SubjectData> subjects;
+
+    FlatViconFrame() = default;
+    explicit FlatViconFrame(const ViconFrame& frame);
+
+    //! Get number of subjects in the frame.
+    size_t num_subjects() const
+    {
+        return subjects.size();
+    }
+
+    /**
+     * @brief Get index of the subject with the given name.
+     *
+     * @return Index of the subject in @ref subjects or std::nullopt if there
+     *      is no subject with that name.
+     */
+    std::optional<size_t> find_subject(const std::string& subject_name) const;
+
+    /**
+     * @brief Set content from the given ViconFrame.
+     *
+     * The name table is only replaced if the set of subjects differs from the
+     * current one, i.e. no memory is allocated if it is the same.
+     */
+    void assign(const ViconFrame& frame);
+
+    /**
+     * @brief Write content to the given ViconFrame (see copy_frame()).
+     *
+     * @throws std::invalid_argument if the size of @ref subjects does not match
+     *      the number of subject names.
+     */
+    void to_vicon_frame(ViconFrame& frame) const;
+
+    //! Convert to ViconFrame.
+    ViconFrame to_vicon_frame() const;
+
+    template <class Archive>
+    void save(Archive& archive) const
+    {
+        int format_version = 4;
+        archive(CEREAL_NVP(format_version),
+                CEREAL_NVP(frame_number),
+                CEREAL_NVP(frame_rate),
+                CEREAL_NVP(latency),
+                CEREAL_NVP(time_stamp),
+                cereal::make_nvp("subject_names", *subject_names),
+                CEREAL_NVP(subjects));
+    }
+
+    template <class Archive>
+    void load(Archive& archive)
+    {
+        int format_version;
+        archive(CEREAL_NVP(format_version));
+        if (format_version != 4)
+        {
+            throw std::runtime_error("Invalid input format");
+        }
+
+        NameTable names;
+        archive(CEREAL_NVP(frame_number),
+                CEREAL_NVP(frame_rate),
+                CEREAL_NVP(latency),
+                CEREAL_NVP(time_stamp),
+                cereal::make_nvp("subject_names", names),
+                CEREAL_NVP(subjects));
+
+        if (names.size() != subjects.size())
+        {
+            throw std::runtime_error(
+                "Invalid input: Number of subject names and subjects differ.");
+        }
+        // find_subject() does a binary search, so the table has to be sorted
+        // and must not contain duplicates.
+        if (std::adjacent_find(names.begin(),
+                               names.end(),
+                               std::greater_equal<std::string>()) != names.end())
+        {
+            throw std::runtime_error(
+                "Invalid input: Subject names are not sorted or not unique.");
+        }
+        subject_names = std::make_shared<const NameTable>(std::move(names));
+    }
+
+    //! Shared empty name table used by default-constructed frames.
+    static std::shared_ptr<const NameTable> empty_name_table();
+};
+
+/**
+ * @brief Poses of all subjects of a frame in matrix form.
+ *
+ * This provides the data of all subjects at once in a layout that maps
+ * directly to numpy arrays, so the Python bindings don't need one call per
+ * subject.
+ */
+struct SubjectPoses
+{
+    //! Matrix with one row (tx, ty, tz, qx, qy, qz, qw) per subject.
+    using Matrix = Eigen::Matrix<double, Eigen::Dynamic, 7, Eigen::RowMajor>;
+
+    //! Names of the subjects in the order of the rows.
+    std::vector<std::string> names;
+    //! Poses of the subjects.  Rows of subjects that are not visible are NaN.
+    Matrix poses;
+    //! Visibility of the subjects.
+    Eigen::Array<bool, Eigen::Dynamic, 1> is_visible;
+
+    SubjectPoses() = default;
+    explicit SubjectPoses(const ViconFrame& frame);
+    explicit SubjectPoses(const FlatViconFrame& frame);
+
+    //! Resize to the given number of subjects (names are not changed).
+    void resize(size_t num_subjects);
+
+    /**
+     * @brief Set the pose of the subject at the given index.
+     *
+     * If the subject is not visible, the row is set to NaN instead, so it
+     * cannot be confused with a valid pose.
+     */
+    void set(size_t index,
+             bool visible,
+             const spatial_transformation::Transformation& pose);
+};
+
 /**
  * @brief This is an alternative to ViconFrame with a fixed number of subjects.
  *
@@ -187,6 +375,20 @@ struct FixedSizeViconFrame
     double latency = 0.0;
     //! Time stamp when the frame was acquired.
     int64_t time_stamp = 0;
+    /**
+     * @brief Time between reception of the frame and the moment it was
+     * provided by the o80 driver (in nanoseconds).
+     *
+     * Only set by o80Driver with acquisition thread, otherwise zero.
+     */
+    int64_t age_ns = 0;
+    /**
+     * @brief Number of frames that were dropped by the o80 driver since the
+     * previous observation, because a newer frame arrived.
+     *
+     * Only set by o80Driver with acquisition thread, otherwise zero.
+     */
+    uint64_t frames_missed = 0;
 
     /**
      * @brief List of subjects.
@@ -204,9 +406,10 @@ struct FixedSizeViconFrame
     template <class Archive>
     void serialize(Archive& archive)
     {
-        int format_version = 4;
+        int format_version = 5;
         archive(CEREAL_NVP(format_version));
-        if (format_version != 4)
+        // version 4 did not have the staleness fields
+        if (format_version != 4 && format_version != 5)
         {
             throw std::runtime_error("Invalid input format");
         }
@@ -216,9 +419,124 @@ struct FixedSizeViconFrame
                 CEREAL_NVP(latency),
                 CEREAL_NVP(time_stamp),
                 CEREAL_NVP(subjects));
+        if (format_version >= 5)
+        {
+            archive(CEREAL_NVP(age_ns), CEREAL_NVP(frames_missed));
+        }
     }
 };
 
+/**
+ * @brief SubjectData in a packed memory layout with fixed offsets.
+ *
+ * Other than SubjectData (whose layout depends on the implementation of
+ * Transformation), this is a plain struct of 72 bytes without any implicit
+ * padding, so it can be shared with other languages (e.g. as numpy structured
+ * array, see @ref PackedViconFrame).
+ *
+ * | Offset | Type      | Field                                |
+ * |--------|-----------|--------------------------------------|
+ * | 0      | double[3] | translation (x, y, z)                |
+ * | 24     | double[4] | rotation quaternion (x, y, z, w)     |
+ * | 56     | double    | quality                              |
+ * | 64     | uint8     | is_visible (0 or 1)                  |
+ * | 65     | uint8[7]  | padding (always zero)                |
+ *
+ * All values of subjects that are not visible are zero.
+ */
+struct PackedSubjectData
+{
+    std::array<double, 3> translation = {};
+    std::array<double, 4> rotation = {};
+    double quality = 0.0;
+    uint8_t is_visible = 0;
+    std::array<uint8_t, 7> padding = {};
+
+    PackedSubjectData() = default;
+    explicit PackedSubjectData(const SubjectData& subject);
+
+    //! Convert to SubjectData.
+    SubjectData unpack() const;
+};
+
+static_assert(std::is_standard_layout_v<PackedSubjectData>);
+static_assert(sizeof(PackedSubjectData) == 72);
+static_assert(offsetof(PackedSubjectData, rotation) == 24);
+static_assert(offsetof(PackedSubjectData, quality) == 56);
+static_assert(offsetof(PackedSubjectData, is_visible) == 64);
+
+/**
+ * @brief FixedSizeViconFrame in a packed memory layout with fixed offsets.
+ *
+ * Meant for exchanging frames with other languages without converting them
+ * field by field.  The Python bindings register it as numpy dtype, so a list
+ * of frames can be provided as a single structured array.
+ *
+ * | Offset | Type                  | Field                      |
+ * |--------|-----------------------|----------------------------|
+ * | 0      | int64                 | time_stamp                 |
+ * | 8      | int32                 | frame_number               |
+ * | 12     | uint32                | num_subjects (NUM_SUBJECTS)|
+ * | 16     | double                | frame_rate                 |
+ * | 24     | double                | latency                    |
+ * | 32     | int64                 | age_ns                     |
+ * | 40     | uint64                | frames_missed              |
+ * | 48     | PackedSubjectData[N]  | subjects                   |
+ *
+ * All values are in native byte order.
+ */
+template <size_t NUM_SUBJECTS>
+struct PackedViconFrame
+{
+    int64_t time_stamp = 0;
+    int32_t frame_number = 0;
+    uint32_t num_subjects = NUM_SUBJECTS;
+    double frame_rate = 0.0;
+    double latency = 0.0;
+    int64_t age_ns = 0;
+    uint64_t frames_missed = 0;
+    std::array<PackedSubjectData, NUM_SUBJECTS> subjects;
+
+    PackedViconFrame() = default;
+
+    explicit PackedViconFrame(const FixedSizeViconFrame<NUM_SUBJECTS>& frame)
+        : time_stamp(frame.time_stamp),
+          frame_number(frame.frame_number),
+          frame_rate(frame.frame_rate),
+          latency(frame.latency),
+          age_ns(frame.age_ns),
+          frames_missed(frame.frames_missed)
+    {
+        for (size_t i = 0; i < NUM_SUBJECTS; i++)
+        {
+            subjects[i] = PackedSubjectData(frame.subjects[i]);
+        }
+    }
+
+    //! Convert to FixedSizeViconFrame.
+    FixedSizeViconFrame<NUM_SUBJECTS> unpack() const
+    {
+        FixedSizeViconFrame<NUM_SUBJECTS> frame;
+        frame.frame_number = frame_number;
+        frame.frame_rate = frame_rate;
+        frame.latency = latency;
+        frame.time_stamp = time_stamp;
+        frame.age_ns = age_ns;
+        frame.frames_missed = frames_missed;
+        for (size_t i = 0; i < NUM_SUBJECTS; i++)
+        {
+            frame.subjects[i] = subjects[i].unpack();
+        }
+        return frame;
+    }
+};
+
+static_assert(std::is_standard_layout_v<PackedViconFrame<1>>);
+static_assert(offsetof(PackedViconFrame<1>, frame_rate) == 16);
+static_assert(offsetof(PackedViconFrame<1>, age_ns) == 32);
+static_assert(offsetof(PackedViconFrame<1>, subjects) == 48);
+static_assert(sizeof(PackedViconFrame<2>) == 48 + 2 * 72);
+
 template <size_t N>
 std::ostream& operator<<(std::ostream& os, const FixedSizeViconFrame<N>& vf)
 {
@@ -226,6 +544,8 @@ std::ostream& operator<<(std::ostream& os, const FixedSizeViconFrame<N>& vf)
     fmt::print(os, "Frame Rate: {}\n", vf.frame_rate);
     fmt::print(os, "Latency: {}\n", vf.latency);
     fmt::print(os, "Timestamp: {}\n", vf.time_stamp);
+    fmt::print(os, "Age: {} ns\n", vf.age_ns);
+    fmt::print(os, "Frames missed: {}\n", vf.frames_missed);
 
     fmt::print(os, "Subjects ({}):\n", vf.subjects.size());
     for (auto const& data : vf.subjects)
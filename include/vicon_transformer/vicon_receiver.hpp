@@ -6,7 +6,13 @@
  */
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <filesystem>
+#include <mutex>
+#include <thread>
 
 #include <spdlog/logger.h>
 #include <vicon-datastream-sdk/DataStreamClient.h>
@@ -14,6 +20,8 @@
 #include <cereal/types/string.hpp>
 #include <cereal/types/vector.hpp>
 
+#include "recording.hpp"
+#include "triple_buffer.hpp"
 #include "types.hpp"
 
 namespace vicon_transformer
@@ -51,12 +59,25 @@ struct ViconReceiverConfig
      */
     std::vector<std::string> filtered_subjects;
 
+    /**
+     * @brief Acquire frames in a separate thread.
+     *
+     * If enabled, a background thread is started on connect(), which
+     * continuously pulls frames from the Vicon server.  @ref
+     * ViconReceiver::read() then returns the newest frame that was received
+     * (only blocking if no frame newer than the last one returned has arrived
+     * yet), so the caller does not have to wait for the round-trip to the
+     * server.  Frames that are not fetched in time are dropped.
+     */
+    bool use_acquisition_thread = false;
+
     template <class Archive>
     void serialize(Archive& archive)
     {
         archive(CEREAL_NVP(enable_lightweight),
                 CEREAL_NVP(buffer_size),
-                CEREAL_NVP(filtered_subjects));
+                CEREAL_NVP(filtered_subjects),
+                CEREAL_NVP(use_acquisition_thread));
     }
 };
 
@@ -76,6 +97,22 @@ public:
      * @return The acquired frame.
      */
     virtual ViconFrame read() = 0;
+
+    /**
+     * @brief Get new frame and write it to the given frame instance.
+     *
+     * Like @ref read() but updates the given frame in place.  Implementations
+     * are expected to reuse the memory of the frame, such that no memory is
+     * allocated as long as the set of subjects does not change.
+     *
+     * The default implementation simply assigns the result of @ref read().
+     *
+     * @param frame The acquired frame is written to this instance.
+     */
+    virtual void read_into(ViconFrame& frame)
+    {
+        frame = read();
+    }
 };
 
 /**
@@ -111,10 +148,28 @@ public:
     //! Print some info about the server configuration.
     void print_info() const;
 
-    //! Get a new frame from the Vicon system.
+    /**
+     * @brief Get a new frame from the Vicon system.
+     *
+     * If @ref ViconReceiverConfig::use_acquisition_thread is set, this returns
+     * the newest frame received by the acquisition thread.  Otherwise the frame
+     * is requested from the server directly.
+     *
+     * @throws NotConnectedError if not connected to the Vicon server (also if
+     *      disconnect() is called while waiting for a frame of the acquisition
+     *      thread).
+     */
     ViconFrame read() override;
 
-    //! Print detailed latency information.
+    //! Like @ref read() but reuses the memory of the given frame.
+    void read_into(ViconFrame& frame) override;
+
+    /**
+     * @brief Print detailed latency information.
+     *
+     * Note that this accesses the Vicon client directly, so it should not be
+     * called while the acquisition thread is running.
+     */
     void print_latency_info() const;
 
 private:
@@ -124,8 +179,73 @@ private:
     const std::string host_name_;
     const ViconReceiverConfig config_;
 
+    // Members used if config_.use_acquisition_thread is set.
+    std::thread acquisition_thread_;
+    /**
+     * @brief True while the acquisition thread is used.
+     *
+     * Checked by @ref read_into() instead of acquisition_thread_, which must
+     * not be accessed while another thread joins it.
+     */
+    std::atomic<bool> acquisition_running_ = false;
+    std::atomic<bool> stop_acquisition_ = false;
+    TripleBuffer<ViconFrame> latest_frame_;
+    //! Only used to wait for new frames, not for accessing latest_frame_.
+    std::mutex new_frame_mutex_;
+    std::condition_variable new_frame_cond_;
+    //! Exception thrown in the acquisition thread (guarded by the mutex).
+    std::exception_ptr acquisition_error_;
+
+    //! Cached information about a subject (see @ref update_subject_cache).
+    struct SubjectInfo
+    {
+        std::string name;
+        //! Same as name but in the SDK's string type to avoid conversions.
+        ViconDataStreamSDK::CPP::String sdk_name;
+        ViconDataStreamSDK::CPP::String sdk_root_segment;
+    };
+
+    /**
+     * @brief Names and root segments of all subjects, sorted by name.
+     *
+     * Only accessed in receive_frame(), i.e. by the acquisition thread if it is
+     * used.
+     */
+    std::vector<SubjectInfo> subject_cache_;
+
     void client_get_frame();
 
+    //! Get a frame from the client and write it to the given ViconFrame.
+    void receive_frame(ViconFrame& frame);
+
+    /**
+     * @brief Make sure the subjects of the frame match the subject cache.
+     *
+     * If the frame has different subjects, they are replaced by the cached
+     * ones (with default values).
+     */
+    void prepare_subjects(ViconFrame& frame) const;
+
+    /**
+     * @brief Get data of all subjects in the subject cache from the client.
+     *
+     * @param frame Subject data is written to this frame.  Its subjects have to
+     *      match the subject cache (see @ref prepare_subjects()), so they can
+     *      be updated without looking them up by name.
+     * @return False if the subject cache is outdated (i.e. the server does not
+     *      know one of the cached subjects anymore), true on success.
+     */
+    bool read_subjects(ViconFrame& frame);
+
+    //! Query names and root segments of all subjects from the client.
+    void update_subject_cache(unsigned int subject_count);
+
+    void start_acquisition_thread();
+    void stop_acquisition_thread();
+
+    //! Main loop of the acquisition thread.
+    void acquisition_loop();
+
     /**
      * @brief Only receive data for the listed subjects.
      *
@@ -152,6 +272,9 @@ public:
     //! Return the frame that was loaded from the file.
     ViconFrame read() override;
 
+    //! Copy the frame that was loaded from the file to the given instance.
+    void read_into(ViconFrame& frame) override;
+
 private:
     ViconFrame frame_;
 };
@@ -164,8 +287,18 @@ private:
 class PlaybackReceiver : public Receiver
 {
 public:
+    //! Minimum speed factor for paced playback.
+    static constexpr double MIN_PLAYBACK_SPEED = 0.1;
+    //! Maximum speed factor for paced playback.
+    static constexpr double MAX_PLAYBACK_SPEED = 100.0;
+
     /**
-     * @param filename Path to the recorded file.
+     * @param filename Path to the recorded file.  Can be either a streaming
+     *      recording (see RecordingWriter) or a serialised
+     *      std::vector<ViconFrame>.  Streaming recordings are memory-mapped and
+     *      frames are decoded on demand, so opening them is fast, even for
+     *      long recordings.  Old-style recordings are loaded completely when
+     *      opening (use convert_to_recording() to convert them).
      * @param logger A logger instance used for logging output.  If not set, a
      *      logger with name "ViconReceiver" used.
      */
@@ -180,10 +313,124 @@ public:
      */
     ViconFrame read() override;
 
+    /**
+     * @brief Like @ref read() but reuses the memory of the given frame.
+     *
+     * @throws std::out_of_range if end of the recording is reached.
+     */
+    void read_into(ViconFrame& frame) override;
+
+    //! Number of frames in the recording.
+    size_t num_frames() const;
+
+    //! Index of the frame that is returned by the next call of @ref read().
+    size_t current_index() const
+    {
+        return tape_index_;
+    }
+
+    /**
+     * @brief Jump to the frame with the given Vicon frame number.
+     *
+     * The next call of @ref read() returns this frame or, if the recording
+     * does not contain this frame number (e.g. because frames were dropped),
+     * the first frame after it.  Complexity is logarithmic in the number of
+     * frames.
+     *
+     * @throws std::out_of_range if all frames of the recording have a lower
+     *      frame number.
+     */
+    void seek_to_frame(int frame_number);
+
+    /**
+     * @brief Jump to the frame with the given time stamp.
+     *
+     * The next call of @ref read() returns the first frame with a time stamp
+     * not less than the given one.  Complexity is logarithmic in the number of
+     * frames.
+     *
+     * @param time_stamp_ns Time stamp in nanoseconds (see
+     *      ViconFrame::time_stamp).
+     * @throws std::out_of_range if all frames of the recording are older.
+     */
+    void seek_to_time(int64_t time_stamp_ns);
+
+    /**
+     * @brief Get all frames in the time interval [start, end).
+     *
+     * This does not change the position of @ref read().
+     *
+     * @param start_time_stamp_ns Start of the interval (inclusive).
+     * @param end_time_stamp_ns End of the interval (exclusive).
+     * @return Frames with time stamps in the given interval.
+     */
+    std::vector<ViconFrame> read_range(int64_t start_time_stamp_ns,
+                                       int64_t end_time_stamp_ns);
+
+    /**
+     * @brief Play back the recording at the rate at which it was recorded.
+     *
+     * If enabled, @ref read() blocks until the time that passed between the
+     * returned frame and the first frame read after enabling (based on
+     * ViconFrame::time_stamp) has elapsed, scaled by the given speed factor.
+     * Waiting is done with respect to this reference frame, not the previous
+     * one, so small delays of the caller do not accumulate.
+     *
+     * The reference is reset when seeking or changing the speed.
+     *
+     * @param speed Speed factor in the range [MIN_PLAYBACK_SPEED,
+     *      MAX_PLAYBACK_SPEED] (e.g. 2.0 for playing back at double speed) or 0
+     *      to disable pacing (the default), in which case frames are returned
+     *      as fast as @ref read() is called.
+     * @throws std::invalid_argument if speed is out of range.
+     */
+    void set_playback_speed(double speed);
+
+    //! Get the speed factor of paced playback (0 if pacing is disabled).
+    double get_playback_speed() const
+    {
+        return playback_speed_;
+    }
+
+    /**
+     * @brief Replace the time stamps of returned frames with the current time.
+     *
+     * This is useful to make played back frames look like they were just
+     * received from a live system (e.g. when combining it with other live
+     * data).  The time stamps in the file are still used for pacing and
+     * seeking.
+     */
+    void set_rewrite_time_stamps(bool enable)
+    {
+        rewrite_time_stamps_ = enable;
+    }
+
+    //! Check if time stamps are replaced with the current time.
+    bool is_rewrite_time_stamps_enabled() const
+    {
+        return rewrite_time_stamps_;
+    }
+
 private:
     std::shared_ptr<spdlog::logger> log_;
+    //! Frames of old-style recordings, which are loaded completely.
     std::vector<ViconFrame> tape_;
+    //! Streaming recordings are decoded lazily.
+    std::unique_ptr<RecordingReader> recording_;
     size_t tape_index_;
+
+    double playback_speed_ = 0.0;
+    bool rewrite_time_stamps_ = false;
+    //! Whether the reference for pacing has been set.
+    bool pacing_started_ = false;
+    std::chrono::steady_clock::time_point pacing_start_time_;
+    int64_t pacing_start_time_stamp_ = 0;
+
+    //! Block until the frame with the given time stamp is due.
+    void wait_for_playback_time(int64_t time_stamp_ns);
+
+    //! Index of the first frame with a time stamp not less than the given one.
+    size_t find_time_stamp(int64_t time_stamp_ns);
 };
 
 }  // namespace vicon_transformer
@@ -6,7 +6,9 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -15,12 +17,51 @@
 
 #include <spatial_transformation/transformation.hpp>
 
+#include "batch_transform.hpp"
+#include "pose_history.hpp"
 #include "vicon_receiver.hpp"
 
 namespace vicon_transformer
 {
 using spatial_transformation::Transformation;
 
+/**
+ * @brief Handle for fast access to a subject in @ref ViconTransformer.
+ *
+ * A handle is obtained once via ViconTransformer::resolve() and can then be
+ * used instead of the subject name to query the subject's data without any
+ * name lookup.
+ *
+ * A handle is only valid as long as the set of subjects provided by the
+ * receiver does not change.  Use ViconTransformer::is_valid() to check this
+ * and resolve the name again if needed.
+ */
+class SubjectHandle
+{
+public:
+    //! Construct an invalid handle.
+    SubjectHandle() = default;
+
+    //! Index of the subject in FlatViconFrame::subjects.
+    size_t index() const
+    {
+        return index_;
+    }
+
+private:
+    friend class ViconTransformer;
+
+    SubjectHandle(std::shared_ptr<const FlatViconFrame::NameTable> name_table,
+                  size_t index)
+        : name_table_(std::move(name_table)), index_(index)
+    {
+    }
+
+    //! Name table of the frame for which the handle was resolved.
+    std::shared_ptr<const FlatViconFrame::NameTable> name_table_;
+    size_t index_ = 0;
+};
+
 /**
  * @brief Get data from a ViconReceiver and provide poses of subjects relative
  * to an "origin subject".
@@ -56,10 +97,23 @@ public:
     //! Return a const pointer to the receiver instance.
     std::shared_ptr<const Receiver> receiver() const;
 
-    //! Update transformations by getting a new frame from the receiver.
+    /**
+     * @brief Update transformations by getting a new frame from the receiver.
+     *
+     * The frame is read via Receiver::read_into(), so no memory is allocated
+     * as long as the set of subjects does not change.
+     *
+     * @throws SubjectNotVisibleError if the origin subject is not visible in
+     *      the new frame.
+     */
     void update();
 
-    //! Set the Vicon frame that is used by the transformer.
+    /**
+     * @brief Set the Vicon frame that is used by the transformer.
+     *
+     * @throws SubjectNotVisibleError if the origin subject is not visible in
+     *      the frame.
+     */
     void set_frame(const ViconFrame &frame);
 
     /**
@@ -83,6 +137,17 @@ public:
     //! Get list with the names of all registered subjects.
     std::vector<std::string> get_subject_names() const;
 
+    /**
+     * @brief Get the names of the subjects of the current frame without
+     * copying them.
+     *
+     * The same instance is returned as long as the set of subjects does not
+     * change, so comparing the pointers is a cheap way to detect changes (e.g.
+     * to update data that depends on the order of subjects).
+     */
+    std::shared_ptr<const FlatViconFrame::NameTable> get_subject_name_table()
+        const noexcept;
+
     /**
      * @brief Check if the specified subject is visible.
      *
@@ -92,6 +157,36 @@ public:
      */
     bool is_visible(const std::string &subject_name) const;
 
+    /**
+     * @brief Get a handle for faster access to the specified subject.
+     *
+     * The handle refers to the set of subjects of the current frame, so this
+     * can only be called after a frame has been set (e.g. via @ref update()).
+     *
+     * @param subject_name Name of the subject.
+     * @return Handle that can be passed to the handle-based overloads of
+     *      @ref is_visible(), @ref get_transform() and @ref
+     *      get_raw_transform().
+     * @throws UnknownSubjectError if there is no subject with the given name.
+     */
+    SubjectHandle resolve(const std::string &subject_name) const;
+
+    /**
+     * @brief Check if the handle is valid for the current frame.
+     *
+     * Handles become invalid when the set of subjects changes.
+     */
+    bool is_valid(const SubjectHandle &subject) const noexcept;
+
+    /**
+     * @brief Check if the specified subject is visible.
+     *
+     * @param subject Handle of the subject (see @ref resolve()).
+     * @return True if it is visible in the current frame, false if not or if
+     *      the handle is not valid.
+     */
+    bool is_visible(const SubjectHandle &subject) const noexcept;
+
     /**
      * @brief Get transformation of a subject relative to the origin subject.
      *
@@ -102,6 +197,18 @@ public:
      */
     Transformation get_transform(const std::string &subject_name) const;
 
+    /**
+     * @brief Get transformation of a subject relative to the origin subject.
+     *
+     * Other than the name-based version, this does not throw.  If the subject
+     * is not visible (or the handle is not valid), the identity is returned,
+     * so check @ref is_visible() first.
+     *
+     * @param subject Handle of the subject (see @ref resolve()).
+     * @return Transformation from the origin subject to the requested subject.
+     */
+    Transformation get_transform(const SubjectHandle &subject) const noexcept;
+
     /**
      * @brief Get transformation of a subject relative to Vicons global origin.
      *
@@ -117,20 +224,306 @@ public:
      */
     Transformation get_raw_transform(const std::string &subject_name) const;
 
+    /**
+     * @brief Get transformation of a subject relative to Vicons global origin.
+     *
+     * Same as the name-based version but does not throw.  If the subject is
+     * not visible (or the handle is not valid), the identity is returned, so
+     * check @ref is_visible() first.
+     *
+     * @param subject Handle of the subject (see @ref resolve()).
+     * @return Transformation from the Vicon origin to the requested subject.
+     */
+    Transformation get_raw_transform(
+        const SubjectHandle &subject) const noexcept;
+
+    /**
+     * @brief Get transformation of a subject relative to the origin subject.
+     *
+     * Like @ref get_transform() but instead of throwing, an empty result is
+     * returned if the subject is not available.  Use this if the subject may
+     * be occluded in normal operation.
+     *
+     * @param subject_name  Name of the subject
+     * @return Transformation from the origin subject to the requested subject
+     *      or std::nullopt if there is no visible subject with this name.
+     */
+    std::optional<Transformation> try_get_transform(
+        const std::string &subject_name) const noexcept;
+
+    /**
+     * @brief Get transformation of a subject relative to the origin subject.
+     *
+     * @param subject Handle of the subject (see @ref resolve()).
+     * @return Transformation from the origin subject to the requested subject
+     *      or std::nullopt if the subject is not visible or the handle is not
+     *      valid.
+     */
+    std::optional<Transformation> try_get_transform(
+        const SubjectHandle &subject) const noexcept;
+
+    /**
+     * @brief Get transformation of a subject relative to Vicons global origin.
+     *
+     * Like @ref get_raw_transform() but instead of throwing, an empty result is
+     * returned if the subject is not available.
+     *
+     * @param subject_name  Name of the subject
+     * @return Transformation from the Vicon origin to the requested subject or
+     *      std::nullopt if there is no visible subject with this name.
+     */
+    std::optional<Transformation> try_get_raw_transform(
+        const std::string &subject_name) const noexcept;
+
+    /**
+     * @brief Get transformation of a subject relative to Vicons global origin.
+     *
+     * @param subject Handle of the subject (see @ref resolve()).
+     * @return Transformation from the Vicon origin to the requested subject or
+     *      std::nullopt if the subject is not visible or the handle is not
+     *      valid.
+     */
+    std::optional<Transformation> try_get_raw_transform(
+        const SubjectHandle &subject) const noexcept;
+
     /**
      * @brief Get the whole frame data with all subject poses relative to the
      * origin subject.
      */
     ViconFrame get_frame() const;
 
+    /**
+     * @brief Like @ref get_frame() but returns the frame in the flat
+     * representation.
+     *
+     * This is cheaper than get_frame() as the subject names are not copied.
+     */
+    FlatViconFrame get_flat_frame() const;
+
+    /**
+     * @brief Like @ref get_frame() but writes to the given frame instance.
+     *
+     * Memory of the given frame is reused, so no memory is allocated if it
+     * already contains the same set of subjects.
+     */
+    void get_frame_into(ViconFrame &frame) const;
+
+    //! Like @ref get_flat_frame() but writes to the given frame instance.
+    void get_frame_into(FlatViconFrame &frame) const;
+
+    /**
+     * @brief Like @ref get_frame() but writes to a fixed-size frame.
+     *
+     * Subject data is copied directly from the internal storage, without
+     * creating an intermediate frame.
+     *
+     * @param frame The frame to which the data is written.  Subjects that are
+     *      not written are marked as not visible.
+     * @param slots Maps subjects to indices in frame.subjects:
+     *      ``slots[i]`` is the index for the subject ``i`` (in the order of
+     *      @ref get_subject_name_table()).  Subjects without index are skipped.
+     *      All indices must be less than N.
+     */
+    template <size_t N>
+    void get_frame_into(FixedSizeViconFrame<N> &frame,
+                        const std::vector<std::optional<size_t>> &slots) const
+    {
+        frame.frame_number = frame_.frame_number;
+        frame.frame_rate = frame_.frame_rate;
+        frame.latency = frame_.latency;
+        frame.time_stamp = frame_.time_stamp;
+
+        for (SubjectData &subject : frame.subjects)
+        {
+            subject.is_visible = false;
+        }
+
+        const PoseArray &poses = output_poses();
+        const size_t num_subjects =
+            std::min(slots.size(), frame_.subjects.size());
+        for (size_t i = 0; i < num_subjects; i++)
+        {
+            if (!slots[i])
+            {
+                continue;
+            }
+            SubjectData &subject = frame.subjects[*slots[i]];
+            subject = frame_.subjects[i];
+            // only apply origin transform if the subject is actually visible
+            if (subject.is_visible)
+            {
+                subject.global_pose = poses.get(i);
+            }
+        }
+    }
+
+    /**
+     * @brief Get transformations of all subjects relative to the origin
+     * subject at once.
+     *
+     * Subjects are in the same order as in @ref get_subject_names().  Like
+     * @ref get_transform(), this is affected by latency compensation.
+     */
+    SubjectPoses get_all_transforms() const;
+
+    /**
+     * @brief Like @ref get_all_transforms() but writes to the given instance.
+     *
+     * Memory of poses is reused, so no memory is allocated if it already has
+     * the same number of subjects.
+     */
+    void get_all_transforms_into(SubjectPoses &poses) const;
+
+    /**
+     * @brief Enable/disable compensation of the latency of the Vicon system.
+     *
+     * If enabled, the poses of all subjects are extrapolated forward in time
+     * by the latency reported by the Vicon system (ViconFrame::latency) plus
+     * the given additional offset.  This is done based on the velocity of the
+     * subjects, estimated from the current and the previous frame.  Subjects
+     * that are not visible in both frames are not extrapolated.
+     *
+     * The prediction affects @ref get_transform(), @ref try_get_transform()
+     * and @ref get_frame() (and their variants).  The raw transforms and the
+     * history used by @ref get_transform_at() always contain the measured
+     * poses.
+     *
+     * @param enable Whether to enable latency compensation.
+     * @param additional_offset_s Time in seconds that is added to the latency
+     *      reported by Vicon (e.g. to account for delays in further
+     *      processing).  May be negative.
+     */
+    void set_latency_compensation(bool enable,
+                                  double additional_offset_s = 0.0);
+
+    //! Check if latency compensation is enabled.
+    bool is_latency_compensation_enabled() const;
+
+    /**
+     * @brief Set the number of past frames that are kept for @ref
+     * get_transform_at().
+     *
+     * Memory for the history is reused, so once it is full, no more memory is
+     * allocated (as long as the set of subjects does not change).  Changing the
+     * size clears the history.  Set to zero (the default) to disable it.
+     */
+    void set_history_size(size_t num_frames);
+
+    //! Get the number of past frames that are kept.
+    size_t get_history_size() const;
+
+    /**
+     * @brief Get transformation of a subject relative to the origin subject at
+     * the given time.
+     *
+     * Uses the history of the last frames (see @ref set_history_size()).  If
+     * the time lies between two frames, the pose is interpolated (linearly for
+     * the translation, using slerp for the rotation).  The poses are relative
+     * to the origin subject as it was at the time of each frame.  Latency
+     * compensation is not applied to them.
+     *
+     * Frames in which the origin subject was not visible are not added to the
+     * history.  If a frame is received that is older than the newest one in the
+     * history (e.g. when a recording is played back again), the history is
+     * cleared.
+     *
+     * @param subject_name  Name of the subject
+     * @param time_stamp_ns Time stamp in nanoseconds.
+     * @return Transformation from the origin subject to the requested subject
+     *      or std::nullopt if the time is not covered by the history or the
+     *      subject is not visible in the frames before/after the time stamp.
+     */
+    std::optional<Transformation> get_transform_at(
+        const std::string &subject_name, int64_t time_stamp_ns) const noexcept;
+
+    /**
+     * @brief Like the name-based version of @ref get_transform_at().
+     *
+     * Other than the other handle-based methods, this also works with handles
+     * that are not valid anymore, as long as the subject exists in the frames
+     * of the history (it is looked up by name in frames with a different set of
+     * subjects).
+     *
+     * @param subject Handle of the subject (see @ref resolve()).
+     * @param time_stamp_ns Time stamp in nanoseconds.
+     */
+    std::optional<Transformation> get_transform_at(
+        const SubjectHandle &subject, int64_t time_stamp_ns) const noexcept;
+
 protected:
     std::shared_ptr<spdlog::logger> log_;
     std::shared_ptr<Receiver> receiver_;
     std::string origin_subject_name_;
-    ViconFrame frame_;
+    //! Buffer to which frames are read from the receiver.
+    ViconFrame received_frame_;
+    //! The current frame (with the raw poses as provided by the receiver).
+    FlatViconFrame frame_;
     Transformation origin_tf_;
 
+    //! Raw poses of frame_ in SIMD-friendly layout.
+    PoseArray raw_poses_;
+    //! Poses of frame_ relative to the origin subject.
+    PoseArray transformed_poses_;
+    //! Past frames with poses relative to the origin subject.
+    PoseHistory history_;
+
+    bool latency_compensation_ = false;
+    double latency_offset_s_ = 0.0;
+    //! Poses of frame_ relative to the origin, extrapolated by the latency.
+    PoseArray predicted_poses_;
+    //! transformed_poses_ of the previous frame (used for the prediction).
+    PoseArray previous_poses_;
+    std::vector<bool> previous_visible_;
+    std::shared_ptr<const FlatViconFrame::NameTable> previous_subject_names_;
+    int previous_frame_number_ = 0;
+
     const SubjectData &get_subject_data(const std::string &subject_name) const;
+
+    //! Read a new frame from the receiver without updating origin_tf_.
+    void read_frame();
+
+    /**
+     * @brief Update origin_tf_ (and the predicted poses) based on frame_.
+     *
+     * If the origin subject is available, the transformed frame is also added
+     * to the history.
+     *
+     * @return False if the origin subject is not available in the current
+     *      frame (the previous origin_tf_ is used in this case).
+     */
+    bool try_process_frame();
+
+    /**
+     * @brief Like @ref try_process_frame() but throws if the origin subject is
+     * not available.
+     *
+     * @throws UnknownSubjectError if the origin subject does not exist.
+     * @throws SubjectNotVisibleError if the origin subject is not visible.
+     */
+    void process_frame();
+
+    //! Apply the origin transform to all subjects (into transformed_poses_).
+    void transform_all_poses();
+
+    //! Compute predicted_poses_ based on transformed_poses_.
+    void predict_poses();
+
+    /**
+     * @brief Pose of the given subject relative to the origin that is returned
+     * to the user.
+     *
+     * This is either the predicted pose or the current pose, depending on
+     * whether latency compensation is enabled.
+     */
+    Transformation get_output_pose(size_t index) const;
+
+    /**
+     * @brief Poses of all subjects relative to the origin that are returned to
+     * the user.
+     *
+     * Like @ref get_output_pose() but for all subjects at once.
+     */
+    const PoseArray &output_poses() const;
 };
 
 }  // namespace vicon_transformer
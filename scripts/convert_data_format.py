@@ -5,6 +5,9 @@
 The structure in which the Vicon data is provided changed in the past.  This script
 converts files recorded with an older format to the newest one, so they can be used with
 the latest version of the software.
+
+This only applies to the pickle files of the Python receiver.  Recordings of the C++
+implementation (e.g. from ``vicon_record``) are converted with ``vicon_convert``.
 """
 import argparse
 import json
@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <vicon_transformer/batch_transform.hpp>
+
+#include <cassert>
+#include <cmath>
+
+// Compile the kernels for several instruction sets and select the best one
+// supported by the CPU at load time, so AVX2/AVX-512 are used without having to
+// build for a specific machine.  target_clones needs ifunc support, so only
+// use it with GCC on x86-64 Linux.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11 && \
+    defined(__x86_64__) && defined(__linux__)
+#define VICON_TRANSFORMER_SIMD_DISPATCH \
+    __attribute__((                        \
+        target_clones("arch=x86-64-v4", "arch=x86-64-v3", "default")))
+#else
+#define VICON_TRANSFORMER_SIMD_DISPATCH
+#endif
+
+namespace vicon_transformer
+{
+void PoseArray::resize(size_t size)
+{
+    qw.resize(size);
+    qx.resize(size);
+    qy.resize(size);
+    qz.resize(size);
+    tx.resize(size);
+    ty.resize(size);
+    tz.resize(size);
+}
+
+void PoseArray::set(size_t index,
+                    const spatial_transformation::Transformation& pose)
+{
+    qw[index] = pose.rotation.w();
+    qx[index] = pose.rotation.x();
+    qy[index] = pose.rotation.y();
+    qz[index] = pose.rotation.z();
+    tx[index] = pose.translation.x();
+    ty[index] = pose.translation.y();
+    tz[index] = pose.translation.z();
+}
+
+spatial_transformation::Transformation PoseArray::get(size_t index) const
+{
+    return spatial_transformation::Transformation(
+        Eigen::Quaterniond(qw[index], qx[index], qy[index], qz[index]),
+        Eigen::Vector3d(tx[index], ty[index], tz[index]));
+}
+
+void PoseArray::gather(const std::vector<SubjectData>& subjects)
+{
+    resize(subjects.size());
+    for (size_t i = 0; i < subjects.size(); i++)
+    {
+        set(i, subjects[i].global_pose);
+    }
+}
+
+void PoseArray::scatter_visible(std::vector<SubjectData>& subjects) const
+{
+    assert(subjects.size() == size());
+
+    for (size_t i = 0; i < subjects.size(); i++)
+    {
+        if (subjects[i].is_visible)
+        {
+            subjects[i].global_pose = get(i);
+        }
+    }
+}
+
+VICON_TRANSFORMER_SIMD_DISPATCH
+void transform_poses(const spatial_transformation::Transformation& tf,
+                     const PoseArray& poses,
+                     PoseArray& result)
+{
+    assert(&poses != &result);
+
+    const size_t n = poses.size();
+    result.resize(n);
+
+    // Components of tf as scalars, so they can be broadcast to all SIMD lanes.
+    const double aw = tf.rotation.w();
+    const double ax = tf.rotation.x();
+    const double ay = tf.rotation.y();
+    const double az = tf.rotation.z();
+    const Eigen::Matrix3d R = tf.rotation.toRotationMatrix();
+    const double r00 = R(0, 0), r01 = R(0, 1), r02 = R(0, 2);
+    const double r10 = R(1, 0), r11 = R(1, 1), r12 = R(1, 2);
+    const double r20 = R(2, 0), r21 = R(2, 1), r22 = R(2, 2);
+    const double t0x = tf.translation.x();
+    const double t0y = tf.translation.y();
+    const double t0z = tf.translation.z();
+
+    // Plain pointers with __restrict__ so the compiler knows that input and
+    // output do not overlap, which is needed for vectorisation.
+    const double* __restrict__ in_qw = poses.qw.data();
+    const double* __restrict__ in_qx = poses.qx.data();
+    const double* __restrict__ in_qy = poses.qy.data();
+    const double* __restrict__ in_qz = poses.qz.data();
+    const double* __restrict__ in_tx = poses.tx.data();
+    const double* __restrict__ in_ty = poses.ty.data();
+    const double* __restrict__ in_tz = poses.tz.data();
+    double* __restrict__ out_qw = result.qw.data();
+    double* __restrict__ out_qx = result.qx.data();
+    double* __restrict__ out_qy = result.qy.data();
+    double* __restrict__ out_qz = result.qz.data();
+    double* __restrict__ out_tx = result.tx.data();
+    double* __restrict__ out_ty = result.ty.data();
+    double* __restrict__ out_tz = result.tz.data();
+
+#pragma omp simd
+    for (size_t i = 0; i < n; i++)
+    {
+        const double bw = in_qw[i], bx = in_qx[i], by = in_qy[i],
+                     bz = in_qz[i];
+
+        // rotation: Hamilton product tf.rotation * pose.rotation
+        out_qw[i] = aw * bw - ax * bx - ay * by - az * bz;
+        out_qx[i] = aw * bx + ax * bw + ay * bz - az * by;
+        out_qy[i] = aw * by - ax * bz + ay * bw + az * bx;
+        out_qz[i] = aw * bz + ax * by - ay * bx + az * bw;
+
+        // translation: tf.rotation * pose.translation + tf.translation
+        const double x = in_tx[i], y = in_ty[i], z = in_tz[i];
+        out_tx[i] = r00 * x + r01 * y + r02 * z + t0x;
+        out_ty[i] = r10 * x + r11 * y + r12 * z + t0y;
+        out_tz[i] = r20 * x + r21 * y + r22 * z + t0z;
+    }
+}
+
+VICON_TRANSFORMER_SIMD_DISPATCH
+void extrapolate_poses(const PoseArray& previous,
+                       const PoseArray& current,
+                       double factor,
+                       PoseArray& result)
+{
+    assert(previous.size() == current.size());
+    assert(&previous != &result && &current != &result);
+
+    const size_t n = current.size();
+    result.resize(n);
+
+    const double* __restrict__ prev_qw = previous.qw.data();
+    const double* __restrict__ prev_qx = previous.qx.data();
+    const double* __restrict__ prev_qy = previous.qy.data();
+    const double* __restrict__ prev_qz = previous.qz.data();
+    const double* __restrict__ prev_tx = previous.tx.data();
+    const double* __restrict__ prev_ty = previous.ty.data();
+    const double* __restrict__ prev_tz = previous.tz.data();
+    const double* __restrict__ cur_qw = current.qw.data();
+    const double* __restrict__ cur_qx = current.qx.data();
+    const double* __restrict__ cur_qy = current.qy.data();
+    const double* __restrict__ cur_qz = current.qz.data();
+    const double* __restrict__ cur_tx = current.tx.data();
+    const double* __restrict__ cur_ty = current.ty.data();
+    const double* __restrict__ cur_tz = current.tz.data();
+    double* __restrict__ out_qw = result.qw.data();
+    double* __restrict__ out_qx = result.qx.data();
+    double* __restrict__ out_qy = result.qy.data();
+    double* __restrict__ out_qz = result.qz.data();
+    double* __restrict__ out_tx = result.tx.data();
+    double* __restrict__ out_ty = result.ty.data();
+    double* __restrict__ out_tz = result.tz.data();
+
+#pragma omp simd
+    for (size_t i = 0; i < n; i++)
+    {
+        out_tx[i] = cur_tx[i] + factor * (cur_tx[i] - prev_tx[i]);
+        out_ty[i] = cur_ty[i] + factor * (cur_ty[i] - prev_ty[i]);
+        out_tz[i] = cur_tz[i] + factor * (cur_tz[i] - prev_tz[i]);
+
+        // q and -q describe the same rotation, so flip the previous quaternion
+        // if needed to extrapolate along the shorter path.
+        const double dot = cur_qw[i] * prev_qw[i] + cur_qx[i] * prev_qx[i] +
+                           cur_qy[i] * prev_qy[i] + cur_qz[i] * prev_qz[i];
+        const double sign = dot < 0.0 ? -1.0 : 1.0;
+
+        const double qw = cur_qw[i] + factor * (cur_qw[i] - sign * prev_qw[i]);
+        const double qx = cur_qx[i] + factor * (cur_qx[i] - sign * prev_qx[i]);
+        const double qy = cur_qy[i] + factor * (cur_qy[i] - sign * prev_qy[i]);
+        const double qz = cur_qz[i] + factor * (cur_qz[i] - sign * prev_qz[i]);
+        const double inv_norm =
+            1.0 / std::sqrt(qw * qw + qx * qx + qy * qy + qz * qz);
+
+        out_qw[i] = qw * inv_norm;
+        out_qx[i] = qx * inv_norm;
+        out_qy[i] = qy * inv_norm;
+        out_qz[i] = qz * inv_norm;
+    }
+}
+
+}  // namespace vicon_transformer
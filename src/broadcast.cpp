@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <csignal>
+#include <string>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <cli_utils/program_options.hpp>
+
+#include <vicon_transformer/shared_memory_broadcast.hpp>
+#include <vicon_transformer/vicon_receiver.hpp>
+
+namespace
+{
+volatile std::sig_atomic_t g_stop = 0;
+
+void handle_signal(int)
+{
+    g_stop = 1;
+}
+
+// Class to get console arguments
+class Args : public cli_utils::ProgramOptions
+{
+public:
+    std::string host_name;
+    std::string shm_name = "vicon_frames";
+    uint32_t num_slots =
+        vicon_transformer::SharedMemoryPublisher::DEFAULT_NUM_SLOTS;
+    uint32_t max_frame_size =
+        vicon_transformer::SharedMemoryPublisher::DEFAULT_MAX_FRAME_SIZE;
+    bool take_over = false;
+
+    std::string help() const override
+    {
+        return R"(Receive Vicon data and publish it in shared memory.
+
+Local processes can read the frames with SharedMemoryReceiver, so only a single
+connection to the Vicon server is needed.  Stop with Ctrl+C.
+
+Usage:  vicon_broadcast <vicon-host-name> [options]
+
+)";
+    }
+
+    void add_options(boost::program_options::options_description &options,
+                     boost::program_options::positional_options_description
+                         &positional) override
+    {
+        namespace po = boost::program_options;
+        // clang-format off
+        options.add_options()
+            ("vicon-host-name",
+             po::value<std::string>(&host_name)->required(),
+             "Host name (or IP) of the Vicon PC.")
+            ("name,n",
+             po::value<std::string>(&shm_name),
+             "Name of the shared memory.  Default: vicon_frames")
+            ("num-slots",
+             po::value<uint32_t>(&num_slots),
+             "Number of frames kept in shared memory.  Default: 64")
+            ("max-frame-size",
+             po::value<uint32_t>(&max_frame_size),
+             "Maximum size of an encoded frame in bytes.  Default: 16384")
+            ("take-over",
+             po::bool_switch(&take_over),
+             "Replace the shared memory even if another publisher may still be using it (e.g. after the previous one crashed).")
+            ;
+        // clang-format on
+
+        positional.add("vicon-host-name", 1);
+    }
+};
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    auto logger = spdlog::get("root");
+    if (!logger)
+    {
+        logger = spdlog::stderr_color_mt("root");
+        logger->set_level(spdlog::level::debug);
+    }
+
+    // Program options
+    Args args;
+    if (!args.parse_args(argc, argv))
+    {
+        return 1;
+    }
+
+    // stop cleanly, so the shared memory is removed
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+
+    vicon_transformer::ViconReceiverConfig config;
+    vicon_transformer::ViconReceiver receiver(args.host_name, config, logger);
+    receiver.connect();
+
+    vicon_transformer::SharedMemoryPublisher publisher(
+        args.shm_name, args.num_slots, args.max_frame_size, args.take_over);
+    logger->info("Publish frames to shared memory {}", args.shm_name);
+
+    vicon_transformer::ViconFrame frame;
+    while (!g_stop)
+    {
+        receiver.read_into(frame);
+        publisher.publish(frame);
+    }
+
+    logger->info("Published {} frames", publisher.num_published_frames());
+    receiver.disconnect();
+
+    return 0;
+}
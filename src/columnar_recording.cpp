@@ -0,0 +1,512 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <vicon_transformer/columnar_recording.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <vicon_transformer/errors.hpp>
+#include <vicon_transformer/vicon_receiver.hpp>
+
+// Integers are written in native byte order, so make sure it is the one
+// specified for the file format.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Columnar format is only supported on little-endian systems.");
+
+namespace vicon_transformer
+{
+namespace
+{
+constexpr std::array<char, 8> FILE_MAGIC = {
+    'V', 'I', 'C', 'O', 'N', 'C', 'O', 'L'};
+
+//! magic + format version + number of subjects + number of frames + offset
+constexpr uint64_t FILE_HEADER_SIZE = 8 + 4 + 4 + 8 + 8;
+
+//! Round up to the next multiple of 8.
+constexpr uint64_t align(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+/**
+ * @brief Offsets of the columns, relative to the first column.
+ *
+ * Subject offsets are relative to the start of the subject's columns.
+ */
+struct ColumnLayout
+{
+    uint64_t frame_numbers;
+    uint64_t first_subject;
+    uint64_t rotation;
+    uint64_t quality;
+    uint64_t is_visible;
+    uint64_t subject_size;
+
+    explicit ColumnLayout(uint64_t num_frames)
+        : frame_numbers(num_frames * sizeof(int64_t)),
+          first_subject(frame_numbers + align(num_frames * sizeof(int32_t))),
+          rotation(num_frames * 3 * sizeof(double)),
+          quality(rotation + num_frames * 4 * sizeof(double)),
+          is_visible(quality + num_frames * sizeof(double)),
+          subject_size(is_visible + align(num_frames * sizeof(uint8_t)))
+    {
+    }
+
+    uint64_t subject_offset(size_t subject_index) const
+    {
+        return first_subject + subject_index * subject_size;
+    }
+
+    uint64_t total_size(size_t num_subjects) const
+    {
+        return subject_offset(num_subjects);
+    }
+};
+
+template <typename T>
+void append_value(std::vector<char>& buffer, const T& value)
+{
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T read_value(const char* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+template <typename T>
+T* column(char* data, uint64_t offset)
+{
+    return reinterpret_cast<T*>(data + offset);
+}
+}  // namespace
+
+void export_columnar_recording(const std::filesystem::path& input_file,
+                               const std::filesystem::path& output_file)
+{
+    PlaybackReceiver receiver(input_file);
+    const size_t num_frames = receiver.num_frames();
+
+    // first pass: collect the names of all subjects, so the file size is known
+    // before writing
+    ViconFrame frame;
+    std::set<std::string> name_set;
+    for (size_t i = 0; i < num_frames; i++)
+    {
+        receiver.read_into(frame);
+        for (const auto& [name, _] : frame.subjects)
+        {
+            name_set.insert(name);
+        }
+    }
+    const std::vector<std::string> subject_names(name_set.begin(),
+                                                 name_set.end());
+
+    std::vector<char> header;
+    header.insert(header.end(), FILE_MAGIC.begin(), FILE_MAGIC.end());
+    append_value(header, ColumnarRecording::FORMAT_VERSION);
+    append_value(header, static_cast<uint32_t>(subject_names.size()));
+    append_value(header, static_cast<uint64_t>(num_frames));
+    append_value(header, uint64_t(0));  // data offset, set below
+    for (const std::string& name : subject_names)
+    {
+        append_value(header, static_cast<uint32_t>(name.size()));
+        header.insert(header.end(), name.begin(), name.end());
+    }
+    const uint64_t data_offset = align(header.size());
+    std::memcpy(&header[FILE_HEADER_SIZE - 8], &data_offset, 8);
+
+    const ColumnLayout layout(num_frames);
+    const uint64_t file_size =
+        data_offset + layout.total_size(subject_names.size());
+
+    int fd = open(output_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to open file {}", output_file));
+    }
+    // The file is zero-initialised, so values of invisible subjects don't
+    // need to be written.
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, file_size) == 0)
+    {
+        mapping = mmap(
+            nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to map file {}", output_file));
+    }
+
+    char* out = static_cast<char*>(mapping);
+    try
+    {
+        std::memcpy(out, header.data(), header.size());
+        char* columns = out + data_offset;
+        int64_t* time_stamps = column<int64_t>(columns, 0);
+        int32_t* frame_numbers = column<int32_t>(columns, layout.frame_numbers);
+
+        // second pass: fill the columns
+        if (num_frames > 0)
+        {
+            receiver.seek_to_time(std::numeric_limits<int64_t>::min());
+        }
+        for (size_t i = 0; i < num_frames; i++)
+        {
+            receiver.read_into(frame);
+            time_stamps[i] = frame.time_stamp;
+            frame_numbers[i] = frame.frame_number;
+
+            for (const auto& [name, subject] : frame.subjects)
+            {
+                if (!subject.is_visible)
+                {
+                    continue;
+                }
+
+                const size_t subject_index =
+                    std::lower_bound(
+                        subject_names.begin(), subject_names.end(), name) -
+                    subject_names.begin();
+                char* subject_columns =
+                    columns + layout.subject_offset(subject_index);
+
+                const auto& pose = subject.global_pose;
+                double* translation =
+                    column<double>(subject_columns, 0) + 3 * i;
+                translation[0] = pose.translation.x();
+                translation[1] = pose.translation.y();
+                translation[2] = pose.translation.z();
+                double* rotation =
+                    column<double>(subject_columns, layout.rotation) + 4 * i;
+                rotation[0] = pose.rotation.x();
+                rotation[1] = pose.rotation.y();
+                rotation[2] = pose.rotation.z();
+                rotation[3] = pose.rotation.w();
+                column<double>(subject_columns, layout.quality)[i] =
+                    subject.quality;
+                column<uint8_t>(subject_columns, layout.is_visible)[i] = 1;
+            }
+        }
+
+        if (msync(mapping, file_size, MS_SYNC) != 0)
+        {
+            throw std::runtime_error(
+                fmt::format("Failed to write file {}", output_file));
+        }
+    }
+    catch (...)
+    {
+        munmap(mapping, file_size);
+        throw;
+    }
+    munmap(mapping, file_size);
+}
+
+RecordingColumns load_recording_columns(const std::filesystem::path& filename,
+                                        int64_t start_time_stamp_ns,
+                                        int64_t end_time_stamp_ns)
+{
+    RecordingColumns result;
+
+    PlaybackReceiver receiver(filename);
+    if (receiver.num_frames() == 0 || start_time_stamp_ns >= end_time_stamp_ns)
+    {
+        return result;
+    }
+    try
+    {
+        receiver.seek_to_time(start_time_stamp_ns);
+    }
+    catch (const std::out_of_range&)
+    {
+        // all frames are older than the start time
+        return result;
+    }
+
+    // upper bound for the number of frames
+    const size_t max_frames = receiver.num_frames() - receiver.current_index();
+    result.time_stamps.reserve(max_frames);
+    result.frame_numbers.reserve(max_frames);
+
+    // Subjects are collected in a map while loading, as new subjects may show
+    // up at any frame.  As the set of subjects rarely changes, the columns for
+    // the subjects of a frame are only looked up when it differs from the
+    // previous frame.
+    std::map<std::string, RecordingColumns::Subject> subjects;
+    std::vector<RecordingColumns::Subject*> frame_columns;
+    std::vector<std::string> frame_names;
+
+    ViconFrame frame;
+    while (receiver.current_index() < receiver.num_frames())
+    {
+        receiver.read_into(frame);
+        if (frame.time_stamp >= end_time_stamp_ns)
+        {
+            break;
+        }
+        const size_t frame_index = result.time_stamps.size();
+        result.time_stamps.push_back(frame.time_stamp);
+        result.frame_numbers.push_back(frame.frame_number);
+
+        const bool same_subjects =
+            frame.subjects.size() == frame_names.size() &&
+            std::equal(frame.subjects.begin(),
+                       frame.subjects.end(),
+                       frame_names.begin(),
+                       [](const auto& subject, const std::string& name)
+                       { return subject.first == name; });
+        if (!same_subjects)
+        {
+            frame_names.clear();
+            frame_columns.clear();
+            for (const auto& [name, _] : frame.subjects)
+            {
+                auto [it, is_new] = subjects.try_emplace(name);
+                if (is_new)
+                {
+                    RecordingColumns::Subject& columns = it->second;
+                    columns.translation.reserve(3 * max_frames);
+                    columns.rotation.reserve(4 * max_frames);
+                    columns.quality.reserve(max_frames);
+                    columns.is_visible.reserve(max_frames);
+                    // fill previous frames with zeros
+                    columns.translation.resize(3 * frame_index);
+                    columns.rotation.resize(4 * frame_index);
+                    columns.quality.resize(frame_index);
+                    columns.is_visible.resize(frame_index);
+                }
+                frame_names.push_back(name);
+                frame_columns.push_back(&it->second);
+            }
+        }
+
+        size_t i = 0;
+        for (const auto& [_, subject] : frame.subjects)
+        {
+            RecordingColumns::Subject& columns = *frame_columns[i++];
+            if (subject.is_visible)
+            {
+                const auto& pose = subject.global_pose;
+                columns.translation.insert(columns.translation.end(),
+                                           {pose.translation.x(),
+                                            pose.translation.y(),
+                                            pose.translation.z()});
+                columns.rotation.insert(columns.rotation.end(),
+                                        {pose.rotation.x(),
+                                         pose.rotation.y(),
+                                         pose.rotation.z(),
+                                         pose.rotation.w()});
+                columns.quality.push_back(subject.quality);
+                columns.is_visible.push_back(1);
+            }
+            else
+            {
+                columns.translation.resize(3 * (frame_index + 1));
+                columns.rotation.resize(4 * (frame_index + 1));
+                columns.quality.push_back(0.0);
+                columns.is_visible.push_back(0);
+            }
+        }
+
+        // subjects that are missing in this frame (only possible if the set
+        // of subjects changed)
+        if (subjects.size() != frame_columns.size())
+        {
+            for (auto& [_, columns] : subjects)
+            {
+                if (columns.is_visible.size() == frame_index)
+                {
+                    columns.translation.resize(3 * (frame_index + 1));
+                    columns.rotation.resize(4 * (frame_index + 1));
+                    columns.quality.resize(frame_index + 1);
+                    columns.is_visible.resize(frame_index + 1);
+                }
+            }
+        }
+    }
+
+    result.subject_names.reserve(subjects.size());
+    result.subjects.reserve(subjects.size());
+    for (auto& [name, columns] : subjects)
+    {
+        result.subject_names.push_back(name);
+        result.subjects.push_back(std::move(columns));
+    }
+
+    return result;
+}
+
+ColumnarRecording::ColumnarRecording(const std::filesystem::path& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to open file {}", filename));
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        size_ = file_stat.st_size;
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            data_ = static_cast<const char*>(mapping);
+        }
+    }
+    // the mapping stays valid after closing the file descriptor
+    ::close(fd);
+
+    if (!data_)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to map file {}", filename));
+    }
+
+    try
+    {
+        if (size_ < FILE_HEADER_SIZE ||
+            std::memcmp(data_, FILE_MAGIC.data(), FILE_MAGIC.size()) != 0)
+        {
+            throw std::runtime_error(fmt::format(
+                "File {} is not a columnar Vicon recording.", filename));
+        }
+        const uint32_t version = read_value<uint32_t>(data_ + 8);
+        if (version != FORMAT_VERSION)
+        {
+            throw std::runtime_error(fmt::format(
+                "Unsupported columnar format version {} (expected {})",
+                version,
+                FORMAT_VERSION));
+        }
+        const uint32_t num_subjects = read_value<uint32_t>(data_ + 12);
+        num_frames_ = read_value<uint64_t>(data_ + 16);
+        data_offset_ = read_value<uint64_t>(data_ + 24);
+
+        const std::runtime_error truncated(
+            fmt::format("Columnar recording {} is truncated.", filename));
+
+        uint64_t offset = FILE_HEADER_SIZE;
+        subject_names_.reserve(num_subjects);
+        for (uint32_t i = 0; i < num_subjects; i++)
+        {
+            if (offset + 4 > size_)
+            {
+                throw truncated;
+            }
+            const uint32_t length = read_value<uint32_t>(data_ + offset);
+            offset += 4;
+            if (offset + length > size_)
+            {
+                throw truncated;
+            }
+            subject_names_.emplace_back(data_ + offset, length);
+            offset += length;
+        }
+
+        if (data_offset_ < offset || data_offset_ % 8 != 0 ||
+            data_offset_ > size_)
+        {
+            throw truncated;
+        }
+        // Check the number of frames against the file size before computing
+        // the column offsets, so that a corrupted header cannot make them
+        // overflow.  Alignment padding is at most a few bytes per column, so
+        // the layout below is guaranteed to fit into 64 bits afterwards.
+        const uint64_t bytes_per_frame =
+            sizeof(int64_t) + sizeof(int32_t) +
+            uint64_t(num_subjects) *
+                ((3 + 4 + 1) * sizeof(double) + sizeof(uint8_t));
+        if (num_frames_ > (size_ - data_offset_) / bytes_per_frame)
+        {
+            throw truncated;
+        }
+        const ColumnLayout layout(num_frames_);
+        if (data_offset_ + layout.total_size(num_subjects) > size_)
+        {
+            throw truncated;
+        }
+    }
+    catch (...)
+    {
+        munmap(const_cast<char*>(data_), size_);
+        throw;
+    }
+}
+
+ColumnarRecording::~ColumnarRecording()
+{
+    munmap(const_cast<char*>(data_), size_);
+}
+
+const int64_t* ColumnarRecording::time_stamps() const
+{
+    return reinterpret_cast<const int64_t*>(data_ + data_offset_);
+}
+
+const int32_t* ColumnarRecording::frame_numbers() const
+{
+    const ColumnLayout layout(num_frames_);
+    return reinterpret_cast<const int32_t*>(data_ + data_offset_ +
+                                            layout.frame_numbers);
+}
+
+SubjectColumns ColumnarRecording::subject(const std::string& subject_name) const
+{
+    auto it = std::lower_bound(
+        subject_names_.begin(), subject_names_.end(), subject_name);
+    if (it == subject_names_.end() || *it != subject_name)
+    {
+        throw UnknownSubjectError(subject_name);
+    }
+    return subject(std::distance(subject_names_.begin(), it));
+}
+
+SubjectColumns ColumnarRecording::subject(size_t subject_index) const
+{
+    if (subject_index >= subject_names_.size())
+    {
+        throw std::out_of_range(
+            fmt::format("Invalid subject index {}", subject_index));
+    }
+
+    const ColumnLayout layout(num_frames_);
+    const char* base =
+        data_ + data_offset_ + layout.subject_offset(subject_index);
+
+    SubjectColumns columns;
+    columns.translation = reinterpret_cast<const double*>(base);
+    columns.rotation = reinterpret_cast<const double*>(base + layout.rotation);
+    columns.quality = reinterpret_cast<const double*>(base + layout.quality);
+    columns.is_visible =
+        reinterpret_cast<const uint8_t*>(base + layout.is_visible);
+    return columns;
+}
+
+}  // namespace vicon_transformer
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <cli_utils/program_options.hpp>
+
+#include <vicon_transformer/columnar_recording.hpp>
+#include <vicon_transformer/recording.hpp>
+
+namespace
+{
+// Class to get console arguments
+class Args : public cli_utils::ProgramOptions
+{
+public:
+    std::string in_file;
+    std::string out_file;
+    uint32_t frames_per_chunk = 300;
+    double quantization_step = 0.0;
+    double rotation_quantization_step = 0.0;
+    unsigned int num_threads = 0;
+    bool columnar = false;
+
+    std::string help() const override
+    {
+        return R"(Convert a recording to the current file format.
+
+The input can be a file written by an older version of vicon_record or a
+recording of the current format (e.g. to apply quantisation).  Chunks of frames
+are encoded in parallel.
+
+Only recordings of the C++ implementation are supported.  Pickle files of the
+Python receiver cannot be read; use convert_data_format.py to update those to
+the latest pickle format.
+
+Usage:  vicon_convert <input-file> <output-file> [options]
+
+)";
+    }
+
+    void add_options(boost::program_options::options_description &options,
+                     boost::program_options::positional_options_description
+                         &positional) override
+    {
+        namespace po = boost::program_options;
+        // clang-format off
+        options.add_options()
+            ("input-file",
+             po::value<std::string>(&in_file)->required(),
+             "Path to the recording that is converted.")
+            ("output-file",
+             po::value<std::string>(&out_file)->required(),
+             "Path to which the converted recording is written.")
+            ("frames-per-chunk",
+             po::value<uint32_t>(&frames_per_chunk),
+             "Number of frames per chunk (only used for old-style input files).  Default: 300")
+            ("quantization-step",
+             po::value<double>(&quantization_step),
+             "Round translations (in metres) and quality to multiples of this value to reduce the file size (e.g. 1e-6).  Default: 0 (lossless)")
+            ("rotation-quantization-step",
+             po::value<double>(&rotation_quantization_step),
+             "Round the components of the rotation quaternions to multiples of this value (e.g. 1e-7).  Default: 0 (lossless)")
+            ("threads,j",
+             po::value<unsigned int>(&num_threads),
+             "Number of threads.  Default: number of CPU cores")
+            ("columnar",
+             po::bool_switch(&columnar),
+             "Export to the column-oriented format instead (see ColumnarRecording).")
+            ;
+        // clang-format on
+
+        positional.add("input-file", 1);
+        positional.add("output-file", 1);
+    }
+};
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    auto logger = spdlog::get("root");
+    if (!logger)
+    {
+        logger = spdlog::stderr_color_mt("root");
+        logger->set_level(spdlog::level::debug);
+    }
+
+    // Program options
+    Args args;
+    if (!args.parse_args(argc, argv))
+    {
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    try
+    {
+        if (args.columnar)
+        {
+            vicon_transformer::export_columnar_recording(args.in_file,
+                                                         args.out_file);
+        }
+        else
+        {
+            vicon_transformer::convert_to_recording(
+                args.in_file,
+                args.out_file,
+                args.frames_per_chunk,
+                args.quantization_step,
+                args.rotation_quantization_step,
+                args.num_threads);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        logger->error("Conversion failed: {}", e.what());
+        // do not leave an incomplete output file
+        std::error_code ec;
+        if (std::filesystem::remove(args.out_file, ec))
+        {
+            logger->info("Removed incomplete output file {}", args.out_file);
+        }
+        return 1;
+    }
+    const std::chrono::duration<double> duration =
+        std::chrono::steady_clock::now() - start;
+
+    logger->info("Converted {} to {} in {:.2f} s",
+                 args.in_file,
+                 args.out_file,
+                 duration.count());
+
+    return 0;
+}
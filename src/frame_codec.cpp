@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <vicon_transformer/frame_codec.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+namespace vicon_transformer
+{
+namespace
+{
+//! Flag indicating that the frame contains a new list of subject names.
+constexpr uint8_t FLAG_NEW_NAMES = 0x01;
+
+//! Values must stay well within int64 after quantisation.
+constexpr double MAX_QUANTIZED = 4.0e18;
+
+using SubjectValues = std::array<double, 8>;
+
+SubjectValues get_values(const SubjectData& subject)
+{
+    const auto& pose = subject.global_pose;
+    return {pose.translation.x(),
+            pose.translation.y(),
+            pose.translation.z(),
+            pose.rotation.x(),
+            pose.rotation.y(),
+            pose.rotation.z(),
+            pose.rotation.w(),
+            subject.quality};
+}
+
+//! Quantisation step for each of the values returned by get_values().
+std::array<double, 8> get_steps(double quantization_step,
+                                double rotation_quantization_step)
+{
+    return {quantization_step,
+            quantization_step,
+            quantization_step,
+            rotation_quantization_step,
+            rotation_quantization_step,
+            rotation_quantization_step,
+            rotation_quantization_step,
+            quantization_step};
+}
+
+void set_values(const SubjectValues& values, SubjectData& subject)
+{
+    auto& pose = subject.global_pose;
+    pose.translation = Eigen::Vector3d(values[0], values[1], values[2]);
+    pose.rotation.x() = values[3];
+    pose.rotation.y() = values[4];
+    pose.rotation.z() = values[5];
+    pose.rotation.w() = values[6];
+    subject.quality = values[7];
+}
+
+uint64_t to_bits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double from_bits(uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint8_t read_byte(const char*& pos, const char* end)
+{
+    if (pos == end)
+    {
+        throw std::runtime_error("Unexpected end of encoded frame.");
+    }
+    return static_cast<uint8_t>(*pos++);
+}
+
+//! Check if the subject names of frame are the same as names (in order).
+bool has_subject_names(const ViconFrame& frame,
+                       const std::vector<std::string>& names)
+{
+    if (frame.subjects.size() != names.size())
+    {
+        return false;
+    }
+    auto name_it = names.begin();
+    for (const auto& [name, _] : frame.subjects)
+    {
+        if (name != *name_it++)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace
+
+void append_varint(std::vector<char>& buffer, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+uint64_t read_varint(const char*& pos, const char* end)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        const uint8_t byte = read_byte(pos, end);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Invalid variable-length integer.");
+}
+
+FrameEncoder::FrameEncoder(double quantization_step,
+                           double rotation_quantization_step)
+    : steps_(get_steps(quantization_step, rotation_quantization_step))
+{
+    if (!(quantization_step >= 0.0) || !(rotation_quantization_step >= 0.0))
+    {
+        throw std::invalid_argument(fmt::format(
+            "Quantization steps must not be negative, got {} and {}",
+            quantization_step,
+            rotation_quantization_step));
+    }
+}
+
+void FrameEncoder::reset()
+{
+    has_previous_ = false;
+    names_.clear();
+    previous_.clear();
+    previous_frame_rate_ = 0;
+    previous_latency_ = 0;
+}
+
+void FrameEncoder::encode(const ViconFrame& frame, std::vector<char>& buffer)
+{
+    // the first frame after reset() always needs the names, even if the list
+    // is empty
+    const bool new_names = !has_previous_ || !has_subject_names(frame, names_);
+    buffer.push_back(static_cast<char>(new_names ? FLAG_NEW_NAMES : 0));
+    if (new_names)
+    {
+        names_.clear();
+        append_varint(buffer, frame.subjects.size());
+        for (const auto& [name, _] : frame.subjects)
+        {
+            append_varint(buffer, name.size());
+            buffer.insert(buffer.end(), name.begin(), name.end());
+            names_.push_back(name);
+        }
+        previous_.assign(names_.size(), {});
+    }
+    has_previous_ = true;
+
+    const uint64_t frame_rate = to_bits(frame.frame_rate);
+    const uint64_t latency = to_bits(frame.latency);
+    append_varint(buffer, frame_rate ^ previous_frame_rate_);
+    append_varint(buffer, latency ^ previous_latency_);
+    previous_frame_rate_ = frame_rate;
+    previous_latency_ = latency;
+
+    // visibility bitset
+    const size_t bitset_pos = buffer.size();
+    buffer.resize(bitset_pos + (names_.size() + 7) / 8, 0);
+    size_t i = 0;
+    for (const auto& [_, subject] : frame.subjects)
+    {
+        if (subject.is_visible)
+        {
+            buffer[bitset_pos + i / 8] |= static_cast<char>(1 << (i % 8));
+        }
+        i++;
+    }
+
+    i = 0;
+    for (const auto& [name, subject] : frame.subjects)
+    {
+        // Values of invisible subjects are garbage, so skip them.  previous
+        // is kept, so the next visible frame is encoded relative to the last
+        // valid values.
+        std::array<uint64_t, 8>& previous = previous_[i++];
+        if (!subject.is_visible)
+        {
+            continue;
+        }
+
+        const SubjectValues values = get_values(subject);
+        for (size_t j = 0; j < values.size(); j++)
+        {
+            if (steps_[j] > 0.0)
+            {
+                const double scaled = values[j] / steps_[j];
+                if (!(std::abs(scaled) < MAX_QUANTIZED))
+                {
+                    throw std::invalid_argument(fmt::format(
+                        "Cannot quantize value {} of subject {}",
+                        values[j],
+                        name));
+                }
+                const int64_t quantized = std::llround(scaled);
+                const int64_t delta =
+                    quantized - static_cast<int64_t>(previous[j]);
+                append_varint(buffer, zigzag_encode(delta));
+                previous[j] = static_cast<uint64_t>(quantized);
+            }
+            else
+            {
+                const uint64_t bits = to_bits(values[j]);
+                append_varint(buffer, bits ^ previous[j]);
+                previous[j] = bits;
+            }
+        }
+    }
+}
+
+FrameDecoder::FrameDecoder(double quantization_step,
+                           double rotation_quantization_step)
+    : steps_(get_steps(quantization_step, rotation_quantization_step))
+{
+}
+
+void FrameDecoder::reset()
+{
+    has_previous_ = false;
+    names_.clear();
+    previous_.clear();
+    previous_frame_rate_ = 0;
+    previous_latency_ = 0;
+}
+
+void FrameDecoder::decode(const char* data, size_t size, ViconFrame& frame)
+{
+    const char* pos = data;
+    const char* end = data + size;
+
+    const uint8_t flags = read_byte(pos, end);
+    if (flags & FLAG_NEW_NAMES)
+    {
+        const uint64_t num_subjects = read_varint(pos, end);
+        if (num_subjects > size)
+        {
+            throw std::runtime_error("Invalid number of subjects.");
+        }
+        names_.clear();
+        for (uint64_t i = 0; i < num_subjects; i++)
+        {
+            const uint64_t length = read_varint(pos, end);
+            if (length > static_cast<uint64_t>(end - pos))
+            {
+                throw std::runtime_error("Unexpected end of encoded frame.");
+            }
+            names_.emplace_back(pos, length);
+            pos += length;
+        }
+        previous_.assign(names_.size(), {});
+    }
+    else if (!has_previous_)
+    {
+        throw std::runtime_error(
+            "Encoded frame refers to a previous frame that was not decoded.");
+    }
+    has_previous_ = true;
+
+    previous_frame_rate_ ^= read_varint(pos, end);
+    previous_latency_ ^= read_varint(pos, end);
+    frame.frame_rate = from_bits(previous_frame_rate_);
+    frame.latency = from_bits(previous_latency_);
+
+    const size_t bitset_size = (names_.size() + 7) / 8;
+    if (static_cast<size_t>(end - pos) < bitset_size)
+    {
+        throw std::runtime_error("Unexpected end of encoded frame.");
+    }
+    const char* bitset = pos;
+    pos += bitset_size;
+
+    if (!has_subject_names(frame, names_))
+    {
+        frame.subjects.clear();
+        for (const std::string& name : names_)
+        {
+            frame.subjects.emplace_hint(
+                frame.subjects.end(), name, SubjectData());
+        }
+    }
+
+    size_t i = 0;
+    for (auto& [_, subject] : frame.subjects)
+    {
+        subject.is_visible = (bitset[i / 8] >> (i % 8)) & 1;
+        if (!subject.is_visible)
+        {
+            subject.global_pose =
+                spatial_transformation::Transformation::Identity();
+            subject.quality = 0.0;
+            i++;
+            continue;
+        }
+
+        std::array<uint64_t, 8>& previous = previous_[i];
+        SubjectValues values;
+        for (size_t j = 0; j < values.size(); j++)
+        {
+            const uint64_t encoded = read_varint(pos, end);
+            if (steps_[j] > 0.0)
+            {
+                // unsigned arithmetic, so invalid data cannot overflow
+                previous[j] += static_cast<uint64_t>(zigzag_decode(encoded));
+                values[j] = static_cast<int64_t>(previous[j]) * steps_[j];
+            }
+            else
+            {
+                previous[j] ^= encoded;
+                values[j] = from_bits(previous[j]);
+            }
+        }
+        set_values(values, subject);
+        if (steps_[3] > 0.0)
+        {
+            // rounding the components results in a quaternion that is not
+            // exactly normalised anymore
+            Eigen::Quaterniond& rotation = subject.global_pose.rotation;
+            const double norm = rotation.norm();
+            if (norm > 0.0)
+            {
+                rotation.coeffs() /= norm;
+            }
+        }
+        i++;
+    }
+
+    if (pos != end)
+    {
+        throw std::runtime_error("Unexpected data after encoded frame.");
+    }
+}
+
+}  // namespace vicon_transformer
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <vicon_transformer/pose_history.hpp>
+
+#include <cassert>
+
+namespace vicon_transformer
+{
+using spatial_transformation::Transformation;
+
+PoseHistory::PoseHistory(size_t capacity) : buffer_(capacity)
+{
+}
+
+void PoseHistory::set_capacity(size_t capacity)
+{
+    buffer_.resize(capacity);
+    clear();
+}
+
+void PoseHistory::clear()
+{
+    begin_ = 0;
+    size_ = 0;
+}
+
+FlatViconFrame& PoseHistory::push()
+{
+    assert(!buffer_.empty());
+
+    if (size_ < buffer_.size())
+    {
+        size_++;
+    }
+    else
+    {
+        // overwrite the oldest frame
+        begin_ = (begin_ + 1) % buffer_.size();
+    }
+
+    return buffer_[(begin_ + size_ - 1) % buffer_.size()];
+}
+
+void PoseHistory::add(const FlatViconFrame& frame)
+{
+    if (buffer_.empty())
+    {
+        return;
+    }
+
+    if (size_ > 0 && frame.time_stamp <= newest_time_stamp())
+    {
+        clear();
+    }
+
+    // copy assignment reuses the memory of the overwritten frame
+    push() = frame;
+}
+
+int64_t PoseHistory::oldest_time_stamp() const
+{
+    return at(0).time_stamp;
+}
+
+int64_t PoseHistory::newest_time_stamp() const
+{
+    return at(size_ - 1).time_stamp;
+}
+
+std::optional<Transformation> PoseHistory::get_pose_at(
+    const std::string& subject_name, int64_t time_stamp_ns) const noexcept
+{
+    return get_pose_at(subject_name, nullptr, 0, time_stamp_ns);
+}
+
+std::optional<Transformation> PoseHistory::get_pose_at(
+    const FlatViconFrame::NameTable& names,
+    size_t index,
+    int64_t time_stamp_ns) const noexcept
+{
+    return get_pose_at(names[index], &names, index, time_stamp_ns);
+}
+
+std::optional<Transformation> PoseHistory::get_pose_at(
+    const std::string& subject_name,
+    const FlatViconFrame::NameTable* names,
+    size_t index,
+    int64_t time_stamp_ns) const noexcept
+{
+    if (size_ == 0 || time_stamp_ns < oldest_time_stamp() ||
+        time_stamp_ns > newest_time_stamp())
+    {
+        return std::nullopt;
+    }
+
+    // binary search for the first frame that is not older than time_stamp_ns
+    size_t lower = 0, upper = size_ - 1;
+    while (lower < upper)
+    {
+        size_t mid = lower + (upper - lower) / 2;
+        if (at(mid).time_stamp < time_stamp_ns)
+        {
+            lower = mid + 1;
+        }
+        else
+        {
+            upper = mid;
+        }
+    }
+
+    const FlatViconFrame& after = at(lower);
+    const SubjectData* data_after =
+        find_subject(after, subject_name, names, index);
+    if (!data_after || !data_after->is_visible)
+    {
+        return std::nullopt;
+    }
+    if (after.time_stamp == time_stamp_ns)
+    {
+        return data_after->global_pose;
+    }
+
+    // lower > 0 here, as the time stamp is not older than the oldest frame
+    const FlatViconFrame& before = at(lower - 1);
+    const SubjectData* data_before =
+        find_subject(before, subject_name, names, index);
+    if (!data_before || !data_before->is_visible)
+    {
+        return std::nullopt;
+    }
+
+    const double alpha =
+        static_cast<double>(time_stamp_ns - before.time_stamp) /
+        static_cast<double>(after.time_stamp - before.time_stamp);
+    const Transformation& pose_before = data_before->global_pose;
+    const Transformation& pose_after = data_after->global_pose;
+
+    return Transformation(
+        pose_before.rotation.slerp(alpha, pose_after.rotation),
+        pose_before.translation +
+            alpha * (pose_after.translation - pose_before.translation));
+}
+
+const SubjectData* PoseHistory::find_subject(
+    const FlatViconFrame& frame,
+    const std::string& subject_name,
+    const FlatViconFrame::NameTable* names,
+    size_t index) noexcept
+{
+    if (names && frame.subject_names.get() == names)
+    {
+        return &frame.subjects[index];
+    }
+
+    std::optional<size_t> frame_index = frame.find_subject(subject_name);
+    if (!frame_index)
+    {
+        return nullptr;
+    }
+    return &frame.subjects[*frame_index];
+}
+
+}  // namespace vicon_transformer
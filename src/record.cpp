@@ -1,17 +1,13 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
-#include <fstream>
 #include <string>
-#include <vector>
 
-#include <fmt/format.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
-#include <cereal/archives/binary.hpp>
-#include <cereal/types/vector.hpp>
 
 #include <cli_utils/program_options.hpp>
 
+#include <vicon_transformer/recording.hpp>
 #include <vicon_transformer/vicon_receiver.hpp>
 
 namespace
@@ -23,11 +19,28 @@ public:
     std::string host_name;
     std::string out_file;
     double duration_s = 60.0;
+    uint32_t frames_per_chunk = 300;
+    double quantization_step = 0.0;
+    double rotation_quantization_step = 0.0;
+
+    // Steps used by --quantize.  Micrometres and 1e-7 per quaternion component
+    // are far below the measurement noise of Vicon, but reduce the file size
+    // considerably compared to lossless encoding (see FrameEncoder).
+    static constexpr double DEFAULT_QUANTIZATION_STEP = 1e-6;
+    static constexpr double DEFAULT_ROTATION_QUANTIZATION_STEP = 1e-7;
 
     std::string help() const override
     {
         return R"(Record Vicon data and save to file.
 
+Frames are written to the file while recording, so memory usage does not grow
+with the duration of the recording.
+
+By default, recordings are lossless.  With --quantize, translations are
+rounded to micrometres and rotation quaternion components to multiples of 1e-7,
+which is well below the measurement noise and makes the file about three times
+smaller.
+
 Usage:  vicon_record <vicon-host-name> <output-file> [options]
 
 )";
@@ -49,12 +62,39 @@ Usage:  vicon_record <vicon-host-name> <output-file> [options]
             ("duration,d",
              po::value<double>(&duration_s),
              "How long to record (in seconds).  Default: 60 s")
+            ("frames-per-chunk",
+             po::value<uint32_t>(&frames_per_chunk),
+             "Number of frames written to the file at once.  Default: 300")
+            ("quantize",
+             "Quantise the recorded values to reduce the file size (same as --quantization-step 1e-6 --rotation-quantization-step 1e-7).")
+            ("quantization-step",
+             po::value<double>(&quantization_step),
+             "Round translations (in metres) and quality to multiples of this value to reduce the file size (e.g. 1e-6).  Default: 0 (lossless)")
+            ("rotation-quantization-step",
+             po::value<double>(&rotation_quantization_step),
+             "Round the components of the rotation quaternions to multiples of this value (e.g. 1e-7).  Default: 0 (lossless)")
             ;
         // clang-format on
 
         positional.add("vicon-host-name", 1);
         positional.add("output-file", 1);
     }
+
+    // --quantize only sets the steps that are not specified explicitly
+    void postprocess(const boost::program_options::variables_map &args) override
+    {
+        if (args.count("quantize") > 0)
+        {
+            if (args.count("quantization-step") == 0)
+            {
+                quantization_step = DEFAULT_QUANTIZATION_STEP;
+            }
+            if (args.count("rotation-quantization-step") == 0)
+            {
+                rotation_quantization_step = DEFAULT_ROTATION_QUANTIZATION_STEP;
+            }
+        }
+    }
 };
 }  // namespace
 
@@ -75,35 +115,37 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    std::vector<vicon_transformer::ViconFrame> tape;
-
     vicon_transformer::ViconReceiverConfig config;
     vicon_transformer::ViconReceiver receiver(args.host_name, config, logger);
     receiver.connect();
 
-    vicon_transformer::ViconFrame frame = receiver.read();
+    logger->info("Write to file {}", args.out_file);
+    if (args.quantization_step > 0.0 || args.rotation_quantization_step > 0.0)
+    {
+        logger->info("Quantise values (step: {}, rotation step: {})",
+                     args.quantization_step,
+                     args.rotation_quantization_step);
+    }
+    vicon_transformer::RecordingWriter writer(args.out_file,
+                                              args.frames_per_chunk,
+                                              args.quantization_step,
+                                              args.rotation_quantization_step);
+
+    vicon_transformer::ViconFrame frame;
+    receiver.read_into(frame);
     int64_t duration_ns = args.duration_s * 1e9;
     int64_t end_time = frame.time_stamp + duration_ns;
 
     logger->info("Start recording for {} s...", args.duration_s);
     while (frame.time_stamp < end_time)
     {
-        frame = receiver.read();
-        tape.push_back(frame);
+        receiver.read_into(frame);
+        writer.write(frame);
     }
     logger->info("End recording");
 
-    {
-        logger->info("Safe to file {}", args.out_file);
-        std::ofstream file(args.out_file);
-        cereal::BinaryOutputArchive json_out(file);
-        if (!file.is_open())
-        {
-            throw std::runtime_error(
-                fmt::format("Failed to open file {}", args.out_file));
-        }
-        json_out(tape);
-    }
+    writer.close();
+    logger->info("Recorded {} frames", writer.num_frames());
 
     receiver.disconnect();
 
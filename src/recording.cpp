@@ -0,0 +1,946 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <vicon_transformer/recording.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <ostream>
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/vector.hpp>
+
+#include <vicon_transformer/frame_codec.hpp>
+
+// Integers are written in native byte order, so make sure it is the one
+// specified for the file format.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Recording format is only supported on little-endian systems.");
+
+namespace vicon_transformer
+{
+namespace
+{
+using Magic = std::array<char, 4>;
+using LongMagic = std::array<char, 8>;
+
+constexpr LongMagic FILE_MAGIC = {'V', 'I', 'C', 'O', 'N', 'R', 'E', 'C'};
+constexpr LongMagic FOOTER_MAGIC = {'V', 'R', 'E', 'C', 'E', 'N', 'D', '\0'};
+constexpr Magic CHUNK_MAGIC = {'C', 'H', 'N', 'K'};
+constexpr Magic INDEX_MAGIC = {'I', 'N', 'D', 'X'};
+
+//! magic + format version + frames per chunk + quantisation steps
+constexpr uint64_t FILE_HEADER_SIZE = 8 + 4 + 4 + 8 + 8;
+//! magic + number of frames + payload size + checksum
+constexpr uint64_t CHUNK_HEADER_SIZE = 4 + 4 + 8 + 4;
+//! index offset + magic
+constexpr uint64_t FOOTER_SIZE = 8 + 8;
+//! Size of a RecordingChunkInfo in the file.
+constexpr uint64_t INDEX_ENTRY_SIZE = 8 + 4 + 4 + 4 + 8 + 8;
+
+template <typename T>
+void write_value(std::ostream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T read_value(const char* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+//! Lookup table for the CRC-32 (as used by zlib, polynomial 0xEDB88320).
+constexpr std::array<uint32_t, 256> make_crc32_table()
+{
+    std::array<uint32_t, 256> table = {};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+        }
+        table[i] = value;
+    }
+    return table;
+}
+constexpr std::array<uint32_t, 256> CRC32_TABLE = make_crc32_table();
+
+uint32_t crc32(const char* data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = CRC32_TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^
+              (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+//! Difference a - b as zigzag-encoded integer (wraps instead of overflowing).
+uint64_t encode_difference(int64_t a, int64_t b)
+{
+    const uint64_t difference =
+        static_cast<uint64_t>(a) - static_cast<uint64_t>(b);
+    return zigzag_encode(static_cast<int64_t>(difference));
+}
+
+int64_t apply_difference(int64_t base, uint64_t encoded_difference)
+{
+    return static_cast<int64_t>(
+        static_cast<uint64_t>(base) +
+        static_cast<uint64_t>(zigzag_decode(encoded_difference)));
+}
+
+}  // namespace
+
+bool is_recording_file(const std::filesystem::path& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    LongMagic magic;
+    file.read(magic.data(), magic.size());
+    return file && magic == FILE_MAGIC;
+}
+
+RecordingWriter::RecordingWriter(const std::filesystem::path& filename,
+                                 uint32_t frames_per_chunk,
+                                 double quantization_step,
+                                 double rotation_quantization_step)
+    : file_(filename, std::ios::binary | std::ios::trunc),
+      frames_per_chunk_(frames_per_chunk),
+      quantization_step_(quantization_step),
+      rotation_quantization_step_(rotation_quantization_step),
+      encoder_(quantization_step, rotation_quantization_step)
+{
+    if (!file_.is_open())
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to open file {}", filename));
+    }
+    if (frames_per_chunk_ == 0)
+    {
+        throw std::invalid_argument("frames_per_chunk must be greater than 0");
+    }
+
+    file_.write(FILE_MAGIC.data(), FILE_MAGIC.size());
+    write_value(file_, FORMAT_VERSION);
+    write_value(file_, frames_per_chunk_);
+    write_value(file_, quantization_step_);
+    write_value(file_, rotation_quantization_step_);
+
+    writer_thread_ = std::thread(&RecordingWriter::writer_loop, this);
+}
+
+RecordingWriter::~RecordingWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+        // Errors cannot be reported from the destructor.  Call close()
+        // explicitly to handle them.
+    }
+}
+
+void RecordingWriter::write(const ViconFrame& frame)
+{
+    if (closed_)
+    {
+        throw std::runtime_error("Cannot write to closed recording.");
+    }
+
+    append_frame(frame, encoder_, frame_buffer_, active_);
+    num_frames_++;
+
+    if (active_.info.num_frames >= frames_per_chunk_)
+    {
+        submit_active_chunk();
+    }
+}
+
+RecordingWriter::EncodedChunk RecordingWriter::encode_chunk(
+    const std::vector<ViconFrame>& frames,
+    double quantization_step,
+    double rotation_quantization_step)
+{
+    FrameEncoder encoder(quantization_step, rotation_quantization_step);
+    std::vector<char> frame_buffer;
+    EncodedChunk chunk;
+    for (const ViconFrame& frame : frames)
+    {
+        append_frame(frame, encoder, frame_buffer, chunk);
+    }
+    return chunk;
+}
+
+void RecordingWriter::write_chunk(EncodedChunk&& chunk)
+{
+    if (closed_)
+    {
+        throw std::runtime_error("Cannot write to closed recording.");
+    }
+    if (chunk.info.num_frames == 0)
+    {
+        return;
+    }
+
+    // keep the order of frames
+    if (active_.info.num_frames > 0)
+    {
+        submit_active_chunk();
+    }
+
+    num_frames_ += chunk.info.num_frames;
+    active_ = std::move(chunk);
+    submit_active_chunk();
+}
+
+void RecordingWriter::append_frame(const ViconFrame& frame,
+                                   FrameEncoder& encoder,
+                                   std::vector<char>& frame_buffer,
+                                   EncodedChunk& chunk)
+{
+    // Frame number and time stamp are stored as difference to the previous
+    // frame of the chunk.  The first frame of a chunk is encoded relative to
+    // zero, so chunks can be decoded independently.
+    int64_t previous_frame_number = 0;
+    int64_t previous_time_stamp = 0;
+    if (chunk.info.num_frames == 0)
+    {
+        encoder.reset();
+        chunk.info.first_frame_number = frame.frame_number;
+        chunk.info.first_time_stamp = frame.time_stamp;
+    }
+    else
+    {
+        previous_frame_number = chunk.info.last_frame_number;
+        previous_time_stamp = chunk.info.last_time_stamp;
+    }
+    chunk.info.last_frame_number = frame.frame_number;
+    chunk.info.last_time_stamp = frame.time_stamp;
+
+    frame_buffer.clear();
+    encoder.encode(frame, frame_buffer);
+    append_varint(chunk.data, frame_buffer.size());
+    append_varint(chunk.data,
+                  encode_difference(frame.frame_number, previous_frame_number));
+    append_varint(chunk.data,
+                  encode_difference(frame.time_stamp, previous_time_stamp));
+    chunk.data.insert(
+        chunk.data.end(), frame_buffer.begin(), frame_buffer.end());
+    chunk.info.num_frames++;
+}
+
+void RecordingWriter::close()
+{
+    if (closed_)
+    {
+        return;
+    }
+    closed_ = true;
+
+    // make sure the writer thread is joined, even if submitting fails
+    std::exception_ptr error;
+    if (active_.info.num_frames > 0)
+    {
+        try
+        {
+            submit_active_chunk();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    writer_thread_.join();
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    check_write_error();
+
+    write_index();
+    file_.close();
+    if (!file_)
+    {
+        throw std::runtime_error("Failed to write recording file.");
+    }
+}
+
+void RecordingWriter::abort() noexcept
+{
+    if (closed_)
+    {
+        return;
+    }
+    closed_ = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    writer_thread_.join();
+
+    // close without index and footer
+    file_.close();
+}
+
+void RecordingWriter::submit_active_chunk()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Only blocks if the disk is slower than the rate at which chunks are
+    // filled.
+    cond_.wait(lock, [this] { return !has_pending_ || write_error_; });
+    if (write_error_)
+    {
+        std::rethrow_exception(write_error_);
+    }
+
+    // swap instead of copying, so the memory of both buffers is reused
+    std::swap(active_, pending_);
+    has_pending_ = true;
+    lock.unlock();
+    cond_.notify_all();
+
+    active_.data.clear();
+    active_.info = RecordingChunkInfo();
+}
+
+void RecordingWriter::writer_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cond_.wait(lock, [this] { return has_pending_ || stop_; });
+
+        if (!has_pending_)
+        {
+            // stop_ is set and all chunks are written
+            return;
+        }
+
+        // pending_ is not touched by the other thread while has_pending_ is
+        // set, so the lock can be released while writing.
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            write_chunk_to_file(pending_);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        has_pending_ = false;
+        cond_.notify_all();
+        if (error)
+        {
+            write_error_ = error;
+            return;
+        }
+    }
+}
+
+void RecordingWriter::write_chunk_to_file(const EncodedChunk& chunk)
+{
+    RecordingChunkInfo info = chunk.info;
+    info.offset = file_.tellp();
+
+    file_.write(CHUNK_MAGIC.data(), CHUNK_MAGIC.size());
+    write_value(file_, info.num_frames);
+    write_value(file_, static_cast<uint64_t>(chunk.data.size()));
+    write_value(file_, crc32(chunk.data.data(), chunk.data.size()));
+    file_.write(chunk.data.data(), chunk.data.size());
+    // flush, so the chunk is on disk even if the process is killed later
+    file_.flush();
+
+    if (!file_)
+    {
+        throw std::runtime_error("Failed to write chunk to recording file.");
+    }
+
+    index_.push_back(info);
+}
+
+void RecordingWriter::write_index()
+{
+    const uint64_t index_offset = file_.tellp();
+
+    file_.write(INDEX_MAGIC.data(), INDEX_MAGIC.size());
+    write_value(file_, static_cast<uint64_t>(index_.size()));
+    for (const RecordingChunkInfo& info : index_)
+    {
+        write_value(file_, info.offset);
+        write_value(file_, info.num_frames);
+        write_value(file_, info.first_frame_number);
+        write_value(file_, info.last_frame_number);
+        write_value(file_, info.first_time_stamp);
+        write_value(file_, info.last_time_stamp);
+    }
+
+    write_value(file_, index_offset);
+    file_.write(FOOTER_MAGIC.data(), FOOTER_MAGIC.size());
+}
+
+void RecordingWriter::check_write_error()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (write_error_)
+    {
+        std::rethrow_exception(write_error_);
+    }
+}
+
+RecordingReader::RecordingReader(const std::filesystem::path& filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to open file {}", filename));
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+        size_ = file_stat.st_size;
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            data_ = static_cast<const char*>(mapping);
+        }
+    }
+    // the mapping stays valid after closing the file descriptor
+    ::close(fd);
+
+    if (!data_)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to map file {}", filename));
+    }
+
+    try
+    {
+        if (size_ < FILE_HEADER_SIZE ||
+            std::memcmp(data_, FILE_MAGIC.data(), FILE_MAGIC.size()) != 0)
+        {
+            throw std::runtime_error(
+                fmt::format("File {} is not a Vicon recording.", filename));
+        }
+        const uint32_t version = read_value<uint32_t>(data_ + 8);
+        if (version != RecordingWriter::FORMAT_VERSION)
+        {
+            throw std::runtime_error(fmt::format(
+                "Unsupported recording format version {} (expected {})",
+                version,
+                RecordingWriter::FORMAT_VERSION));
+        }
+        frames_per_chunk_ = read_value<uint32_t>(data_ + 12);
+        quantization_step_ = read_value<double>(data_ + 16);
+        rotation_quantization_step_ = read_value<double>(data_ + 24);
+        decoder_ =
+            FrameDecoder(quantization_step_, rotation_quantization_step_);
+
+        has_index_ = read_index();
+        if (!has_index_)
+        {
+            scan_chunks();
+        }
+    }
+    catch (...)
+    {
+        munmap(const_cast<char*>(data_), size_);
+        throw;
+    }
+
+    chunk_first_frame_.reserve(chunks_.size());
+    for (const RecordingChunkInfo& info : chunks_)
+    {
+        chunk_first_frame_.push_back(num_frames_);
+        num_frames_ += info.num_frames;
+    }
+}
+
+RecordingReader::~RecordingReader()
+{
+    munmap(const_cast<char*>(data_), size_);
+}
+
+void RecordingReader::read_frame(size_t frame_index, ViconFrame& frame)
+{
+    if (frame_index >= num_frames_)
+    {
+        throw std::out_of_range(
+            fmt::format("Frame index {} is out of range (recording has {} "
+                        "frames)",
+                        frame_index,
+                        num_frames_));
+    }
+
+    // find the last chunk that starts at or before frame_index
+    auto it = std::upper_bound(
+        chunk_first_frame_.begin(), chunk_first_frame_.end(), frame_index);
+    const size_t chunk_index =
+        std::distance(chunk_first_frame_.begin(), it) - 1;
+
+    load_chunk(chunk_index);
+    const size_t index_in_chunk = frame_index - chunk_first_frame_[chunk_index];
+
+    // Frames are encoded relative to their predecessor, so all frames from
+    // the start of the chunk (or the last decoded frame) up to the requested
+    // one need to be decoded.
+    size_t next = decoded_frame_ + 1;
+    if (decoded_frame_ == NO_FRAME || decoded_frame_ >= index_in_chunk)
+    {
+        decoder_.reset();
+        next = 0;
+    }
+    for (; next <= index_in_chunk; next++)
+    {
+        const FrameRef& ref = chunk_frames_[next];
+        decoder_.decode(ref.data, ref.size, frame);
+    }
+    decoded_frame_ = index_in_chunk;
+
+    const FrameRef& ref = chunk_frames_[index_in_chunk];
+    frame.frame_number = ref.frame_number;
+    frame.time_stamp = ref.time_stamp;
+}
+
+size_t RecordingReader::find_frame_number(int frame_number)
+{
+    return lower_bound(&RecordingChunkInfo::last_frame_number,
+                       &FrameRef::frame_number,
+                       frame_number);
+}
+
+size_t RecordingReader::find_time_stamp(int64_t time_stamp_ns)
+{
+    return lower_bound(&RecordingChunkInfo::last_time_stamp,
+                       &FrameRef::time_stamp,
+                       time_stamp_ns);
+}
+
+template <typename T>
+size_t RecordingReader::lower_bound(T RecordingChunkInfo::*chunk_last,
+                                    T FrameRef::*frame_value,
+                                    T value)
+{
+    // first chunk that ends at or after the value
+    auto chunk_it = std::partition_point(
+        chunks_.begin(),
+        chunks_.end(),
+        [&](const RecordingChunkInfo& info)
+        { return info.*chunk_last < value; });
+    if (chunk_it == chunks_.end())
+    {
+        return num_frames_;
+    }
+    const size_t chunk_index = std::distance(chunks_.begin(), chunk_it);
+
+    // the frame headers contain frame number and time stamp, so only the
+    // frame positions have to be parsed, not the frames themselves
+    load_chunk(chunk_index);
+    auto frame_it = std::partition_point(
+        chunk_frames_.begin(),
+        chunk_frames_.end(),
+        [&](const FrameRef& ref) { return ref.*frame_value < value; });
+
+    return chunk_first_frame_[chunk_index] +
+           std::distance(chunk_frames_.begin(), frame_it);
+}
+
+void RecordingReader::read_chunk(size_t chunk_index,
+                                 std::vector<ViconFrame>& frames)
+{
+    const RecordingChunkInfo& info = chunks_.at(chunk_index);
+    const size_t first_frame = chunk_first_frame_[chunk_index];
+    for (size_t i = 0; i < info.num_frames; i++)
+    {
+        read_frame(first_frame + i, frames.emplace_back());
+    }
+}
+
+std::vector<ViconFrame> RecordingReader::read_all()
+{
+    std::vector<ViconFrame> frames;
+    frames.reserve(num_frames_);
+    for (size_t i = 0; i < chunks_.size(); i++)
+    {
+        read_chunk(i, frames);
+    }
+    return frames;
+}
+
+void RecordingReader::decode_chunk(size_t chunk_index,
+                                   std::vector<ViconFrame>& frames) const
+{
+    const RecordingChunkInfo& info = chunks_.at(chunk_index);
+    FrameList refs;
+    if (!parse_chunk(info.offset, refs) || refs.size() != info.num_frames)
+    {
+        throw std::runtime_error(fmt::format(
+            "Invalid chunk at offset {} (file is corrupted)", info.offset));
+    }
+
+    FrameDecoder decoder(quantization_step_, rotation_quantization_step_);
+    for (const FrameRef& ref : refs)
+    {
+        ViconFrame& frame = frames.emplace_back();
+        decoder.decode(ref.data, ref.size, frame);
+        frame.frame_number = ref.frame_number;
+        frame.time_stamp = ref.time_stamp;
+    }
+}
+
+void RecordingReader::load_chunk(size_t chunk_index)
+{
+    if (chunk_index == loaded_chunk_)
+    {
+        return;
+    }
+
+    const RecordingChunkInfo& info = chunks_.at(chunk_index);
+    if (!parse_chunk(info.offset, chunk_frames_) ||
+        chunk_frames_.size() != info.num_frames)
+    {
+        loaded_chunk_ = NO_CHUNK;
+        throw std::runtime_error(fmt::format(
+            "Invalid chunk at offset {} (file is corrupted)", info.offset));
+    }
+    loaded_chunk_ = chunk_index;
+    decoded_frame_ = NO_FRAME;
+}
+
+bool RecordingReader::parse_chunk(uint64_t offset, FrameList& frames) const
+{
+    if (offset > size_ || size_ - offset < CHUNK_HEADER_SIZE ||
+        std::memcmp(data_ + offset, CHUNK_MAGIC.data(), CHUNK_MAGIC.size()) !=
+            0)
+    {
+        return false;
+    }
+
+    const uint32_t num_frames = read_value<uint32_t>(data_ + offset + 4);
+    const uint64_t payload_size = read_value<uint64_t>(data_ + offset + 8);
+    const uint32_t checksum = read_value<uint32_t>(data_ + offset + 16);
+    const uint64_t payload_offset = offset + CHUNK_HEADER_SIZE;
+    if (payload_size > size_ - payload_offset ||
+        crc32(data_ + payload_offset, payload_size) != checksum)
+    {
+        return false;
+    }
+
+    const char* pos = data_ + payload_offset;
+    const char* payload_end = pos + payload_size;
+    frames.clear();
+    int64_t frame_number = 0;
+    int64_t time_stamp = 0;
+    try
+    {
+        for (uint32_t i = 0; i < num_frames; i++)
+        {
+            const uint64_t frame_size = read_varint(pos, payload_end);
+            frame_number =
+                apply_difference(frame_number, read_varint(pos, payload_end));
+            time_stamp =
+                apply_difference(time_stamp, read_varint(pos, payload_end));
+            if (frame_size > static_cast<uint64_t>(payload_end - pos))
+            {
+                return false;
+            }
+
+            FrameRef& ref = frames.emplace_back();
+            ref.data = pos;
+            ref.size = frame_size;
+            ref.frame_number = frame_number;
+            ref.time_stamp = time_stamp;
+            pos += frame_size;
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        // invalid frame header
+        return false;
+    }
+    return pos == payload_end;
+}
+
+bool RecordingReader::read_index()
+{
+    if (size_ < FILE_HEADER_SIZE + FOOTER_SIZE)
+    {
+        return false;
+    }
+
+    const char* footer = data_ + size_ - FOOTER_SIZE;
+    const uint64_t index_offset = read_value<uint64_t>(footer);
+    const bool has_footer_magic =
+        std::memcmp(footer + 8, FOOTER_MAGIC.data(), FOOTER_MAGIC.size()) == 0;
+    if (!has_footer_magic || index_offset < FILE_HEADER_SIZE ||
+        index_offset > size_ - FOOTER_SIZE - 12)
+    {
+        return false;
+    }
+
+    const char* index = data_ + index_offset;
+    const uint64_t num_chunks = read_value<uint64_t>(index + 4);
+    if (std::memcmp(index, INDEX_MAGIC.data(), INDEX_MAGIC.size()) != 0 ||
+        num_chunks > (size_ - index_offset - 12) / INDEX_ENTRY_SIZE)
+    {
+        return false;
+    }
+
+    chunks_.resize(num_chunks);
+    const char* entry = index + 12;
+    for (RecordingChunkInfo& info : chunks_)
+    {
+        info.offset = read_value<uint64_t>(entry);
+        info.num_frames = read_value<uint32_t>(entry + 8);
+        info.first_frame_number = read_value<int32_t>(entry + 12);
+        info.last_frame_number = read_value<int32_t>(entry + 16);
+        info.first_time_stamp = read_value<int64_t>(entry + 20);
+        info.last_time_stamp = read_value<int64_t>(entry + 28);
+        entry += INDEX_ENTRY_SIZE;
+    }
+
+    return true;
+}
+
+void RecordingReader::scan_chunks()
+{
+    chunks_.clear();
+
+    FrameList frames;
+    uint64_t offset = FILE_HEADER_SIZE;
+    while (offset < size_)
+    {
+        if (!parse_chunk(offset, frames) || frames.empty())
+        {
+            // Skip to the next chunk.  If the data was corrupted (and not just
+            // truncated), this allows to recover the chunks after the
+            // corrupted one.  Thanks to the checksum, random occurrences of the
+            // magic bytes in the payload are not mistaken for a chunk.
+            const char* next = std::search(data_ + offset + 1,
+                                           data_ + size_,
+                                           CHUNK_MAGIC.begin(),
+                                           CHUNK_MAGIC.end());
+            offset = next - data_;
+            continue;
+        }
+
+        RecordingChunkInfo info;
+        info.offset = offset;
+        info.num_frames = frames.size();
+        info.first_frame_number = frames.front().frame_number;
+        info.first_time_stamp = frames.front().time_stamp;
+        info.last_frame_number = frames.back().frame_number;
+        info.last_time_stamp = frames.back().time_stamp;
+        chunks_.push_back(info);
+
+        const uint64_t payload_size = read_value<uint64_t>(data_ + offset + 8);
+        offset += CHUNK_HEADER_SIZE + payload_size;
+    }
+}
+
+namespace
+{
+/**
+ * @brief Convert all frames of input_file and pass them to writer.
+ *
+ * See convert_to_recording().  The writer is not closed.
+ */
+void convert_chunks(const std::filesystem::path& input_file,
+                    RecordingWriter& writer,
+                    uint32_t frames_per_chunk,
+                    double quantization_step,
+                    double rotation_quantization_step,
+                    unsigned int num_threads)
+{
+    // declared before the queue, as it is used by the pending tasks
+    std::unique_ptr<RecordingReader> reader;
+    std::ifstream input;
+
+    // Chunks are encoded in parallel and written in order.  The number of
+    // chunks in progress is limited, so memory usage does not depend on the
+    // length of the recording.
+    std::deque<std::future<RecordingWriter::EncodedChunk>> queue;
+    auto write_next = [&queue, &writer]()
+    {
+        writer.write_chunk(queue.front().get());
+        queue.pop_front();
+    };
+    auto submit = [&](auto task)
+    {
+        if (queue.size() >= 2 * num_threads)
+        {
+            write_next();
+        }
+        queue.push_back(std::async(std::launch::async, std::move(task)));
+    };
+
+    if (is_recording_file(input_file))
+    {
+        // Chunks can be decoded independently, so decoding is parallelised
+        // as well.  The chunks of the input are kept.
+        reader = std::make_unique<RecordingReader>(input_file);
+        for (size_t i = 0; i < reader->chunks().size(); i++)
+        {
+            submit(
+                [&reader, i, quantization_step, rotation_quantization_step]()
+                {
+                    std::vector<ViconFrame> frames;
+                    reader->decode_chunk(i, frames);
+                    return RecordingWriter::encode_chunk(
+                        frames, quantization_step, rotation_quantization_step);
+                });
+        }
+    }
+    else
+    {
+        input.open(input_file, std::ios::binary);
+        if (!input.is_open())
+        {
+            throw std::runtime_error(
+                fmt::format("Failed to open file {}", input_file));
+        }
+
+        // The input is a serialised std::vector<ViconFrame>.  Load the frames
+        // one by one instead of the whole vector, so memory usage does not
+        // depend on the length of the recording.  Frames of older format
+        // versions are converted by ViconFrame::serialize().
+        cereal::BinaryInputArchive archive(input);
+        cereal::size_type num_frames;
+        archive(cereal::make_size_tag(num_frames));
+
+        std::vector<ViconFrame> frames;
+        for (cereal::size_type i = 0; i < num_frames; i++)
+        {
+            archive(frames.emplace_back());
+            if (frames.size() == frames_per_chunk || i + 1 == num_frames)
+            {
+                submit(
+                    [frames = std::move(frames),
+                     quantization_step,
+                     rotation_quantization_step]()
+                    {
+                        return RecordingWriter::encode_chunk(
+                            frames,
+                            quantization_step,
+                            rotation_quantization_step);
+                    });
+                frames = std::vector<ViconFrame>();
+            }
+        }
+    }
+
+    while (!queue.empty())
+    {
+        write_next();
+    }
+}
+}  // namespace
+
+void convert_to_recording(const std::filesystem::path& input_file,
+                          const std::filesystem::path& output_file,
+                          uint32_t frames_per_chunk,
+                          double quantization_step,
+                          double rotation_quantization_step,
+                          unsigned int num_threads)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    RecordingWriter writer(output_file,
+                           frames_per_chunk,
+                           quantization_step,
+                           rotation_quantization_step);
+    try
+    {
+        convert_chunks(input_file,
+                       writer,
+                       frames_per_chunk,
+                       quantization_step,
+                       rotation_quantization_step,
+                       num_threads);
+        writer.close();
+    }
+    catch (...)
+    {
+        // do not leave an incomplete file that looks like a valid recording
+        writer.abort();
+        std::error_code ec;
+        std::filesystem::remove(output_file, ec);
+        throw;
+    }
+}
+
+RecoveryResult recover_recording(const std::filesystem::path& input_file,
+                                 const std::filesystem::path& output_file)
+{
+    RecordingReader reader(input_file);
+
+    RecoveryResult result;
+    result.had_index = reader.has_index();
+
+    RecordingWriter writer(output_file,
+                           reader.frames_per_chunk(),
+                           reader.quantization_step(),
+                           reader.rotation_quantization_step());
+    std::vector<ViconFrame> frames;
+    for (size_t i = 0; i < reader.chunks().size(); i++)
+    {
+        frames.clear();
+        try
+        {
+            reader.read_chunk(i, frames);
+        }
+        catch (const std::runtime_error&)
+        {
+            result.num_corrupted_chunks++;
+            continue;
+        }
+
+        for (const ViconFrame& frame : frames)
+        {
+            writer.write(frame);
+        }
+    }
+    writer.close();
+
+    result.num_frames = writer.num_frames();
+    return result;
+}
+
+}  // namespace vicon_transformer
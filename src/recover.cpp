@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <string>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <cli_utils/program_options.hpp>
+
+#include <vicon_transformer/recording.hpp>
+
+namespace
+{
+// Class to get console arguments
+class Args : public cli_utils::ProgramOptions
+{
+public:
+    std::string in_file;
+    std::string out_file;
+
+    std::string help() const override
+    {
+        return R"(Recover the data of an aborted or damaged recording.
+
+All complete chunks with a valid checksum are copied to a new file, which can
+then be played back normally.
+
+Usage:  vicon_recover <input-file> <output-file>
+
+)";
+    }
+
+    void add_options(boost::program_options::options_description &options,
+                     boost::program_options::positional_options_description
+                         &positional) override
+    {
+        namespace po = boost::program_options;
+        // clang-format off
+        options.add_options()
+            ("input-file",
+             po::value<std::string>(&in_file)->required(),
+             "Path to the damaged recording.")
+            ("output-file",
+             po::value<std::string>(&out_file)->required(),
+             "Path to which the recovered data is written.")
+            ;
+        // clang-format on
+
+        positional.add("input-file", 1);
+        positional.add("output-file", 1);
+    }
+};
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    auto logger = spdlog::get("root");
+    if (!logger)
+    {
+        logger = spdlog::stderr_color_mt("root");
+        logger->set_level(spdlog::level::debug);
+    }
+
+    // Program options
+    Args args;
+    if (!args.parse_args(argc, argv))
+    {
+        return 1;
+    }
+
+    vicon_transformer::RecoveryResult result;
+    try
+    {
+        result = vicon_transformer::recover_recording(args.in_file,
+                                                      args.out_file);
+    }
+    catch (const std::exception &e)
+    {
+        logger->error("Recovery failed: {}", e.what());
+        return 1;
+    }
+
+    if (result.had_index && result.num_corrupted_chunks == 0)
+    {
+        logger->info("Input file was not damaged.");
+    }
+    if (result.num_corrupted_chunks > 0)
+    {
+        logger->warn("Skipped {} corrupted chunks.",
+                     result.num_corrupted_chunks);
+    }
+    logger->info("Recovered {} frames to {}", result.num_frames, args.out_file);
+
+    return 0;
+}
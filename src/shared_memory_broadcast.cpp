@@ -0,0 +1,531 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @copyright 2023 Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <vicon_transformer/shared_memory_broadcast.hpp>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fmt/format.h>
+
+namespace vicon_transformer
+{
+namespace
+{
+//! Identifies the shared memory layout (ASCII "VICONSHM").
+constexpr uint64_t SHM_MAGIC = 0x5649434F4E53484D;
+constexpr uint32_t SHM_FORMAT_VERSION = 1;
+
+//! Slots are aligned to cache lines, so writing one does not affect others.
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// The atomics are shared between processes, which only works if they are
+// lock-free.
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<int64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+// The payload is accessed as array of atomic words.
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t));
+
+/**
+ * @brief Header at the beginning of the shared memory.
+ *
+ * The publisher sets magic last, so readers do not use a partially
+ * initialised header.
+ */
+struct alignas(CACHE_LINE_SIZE) SharedHeader
+{
+    std::atomic<uint64_t> magic;
+    uint32_t version;
+    uint32_t num_slots;
+    uint64_t max_frame_size;
+    uint64_t slot_stride;
+    //! Process ID of the publisher (to detect if it crashed).
+    int32_t publisher_pid;
+    //! Written for every frame, so put it in its own cache line.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> num_published;
+    std::atomic<uint32_t> is_closed;
+};
+
+/**
+ * @brief Header of a slot, followed by the encoded frame.
+ *
+ * ``sequence`` is used as seqlock: While frame n is written to the slot, it is
+ * set to 2n + 1, afterwards to 2n + 2.  A reader that sees the same even value
+ * before and after copying the slot knows that the copy is consistent.
+ *
+ * As the slot may be written while it is read, all fields (and the encoded
+ * frame, see copy_to_slot()) are accessed through relaxed atomic operations,
+ * so there is no data race.
+ */
+struct alignas(CACHE_LINE_SIZE) SlotHeader
+{
+    std::atomic<uint64_t> sequence;
+    std::atomic<int64_t> time_stamp;
+    std::atomic<int64_t> frame_number;
+    std::atomic<uint64_t> data_size;
+};
+
+constexpr size_t WORD_SIZE = sizeof(uint64_t);
+
+//! Encoded frame following the header of the given slot.
+std::atomic<uint64_t>* get_slot_data(SlotHeader* slot)
+{
+    return reinterpret_cast<std::atomic<uint64_t>*>(slot + 1);
+}
+
+const std::atomic<uint64_t>* get_slot_data(const SlotHeader* slot)
+{
+    return reinterpret_cast<const std::atomic<uint64_t>*>(slot + 1);
+}
+
+//! Copy data to a slot, word by word with relaxed atomic stores.
+void copy_to_slot(std::atomic<uint64_t>* dest, const char* src, size_t size)
+{
+    const size_t num_full_words = size / WORD_SIZE;
+    for (size_t i = 0; i < num_full_words; i++)
+    {
+        uint64_t word;
+        std::memcpy(&word, src + i * WORD_SIZE, WORD_SIZE);
+        dest[i].store(word, std::memory_order_relaxed);
+    }
+    const size_t remainder = size % WORD_SIZE;
+    if (remainder > 0)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, src + num_full_words * WORD_SIZE, remainder);
+        dest[num_full_words].store(word, std::memory_order_relaxed);
+    }
+}
+
+//! Counterpart of copy_to_slot().
+void copy_from_slot(char* dest, const std::atomic<uint64_t>* src, size_t size)
+{
+    const size_t num_full_words = size / WORD_SIZE;
+    for (size_t i = 0; i < num_full_words; i++)
+    {
+        const uint64_t word = src[i].load(std::memory_order_relaxed);
+        std::memcpy(dest + i * WORD_SIZE, &word, WORD_SIZE);
+    }
+    const size_t remainder = size % WORD_SIZE;
+    if (remainder > 0)
+    {
+        const uint64_t word =
+            src[num_full_words].load(std::memory_order_relaxed);
+        std::memcpy(dest + num_full_words * WORD_SIZE, &word, remainder);
+    }
+}
+
+//! Check if the process with the given ID is running.
+bool is_process_alive(pid_t pid)
+{
+    // signal 0 only checks if the process exists (EPERM means it exists but
+    // belongs to another user)
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+size_t get_slot_stride(uint64_t max_frame_size)
+{
+    const size_t size = sizeof(SlotHeader) + max_frame_size;
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+//! Add a leading "/" to name, if missing (required by shm_open).
+std::string get_shm_name(const std::string& name)
+{
+    if (!name.empty() && name[0] == '/')
+    {
+        return name;
+    }
+    return "/" + name;
+}
+
+/**
+ * @brief Check if the existing shared memory with the given name belongs to a
+ * publisher that was closed or is not running anymore.
+ *
+ * Returns false if the memory is not a valid frame buffer or cannot be read,
+ * so that unrelated objects are not replaced by accident.
+ */
+bool is_unused_segment(const std::string& shm_name)
+{
+    int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    bool is_unused = false;
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) == 0 &&
+        static_cast<size_t>(shm_stat.st_size) >= sizeof(SharedHeader))
+    {
+        void* mapping =
+            mmap(nullptr, sizeof(SharedHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            const SharedHeader* header =
+                static_cast<const SharedHeader*>(mapping);
+            is_unused =
+                header->magic.load(std::memory_order_acquire) == SHM_MAGIC &&
+                header->version == SHM_FORMAT_VERSION &&
+                (header->is_closed.load(std::memory_order_acquire) ||
+                 !is_process_alive(header->publisher_pid));
+            munmap(mapping, sizeof(SharedHeader));
+        }
+    }
+    ::close(fd);
+
+    return is_unused;
+}
+
+const SharedHeader* get_header(const char* data)
+{
+    return reinterpret_cast<const SharedHeader*>(data);
+}
+
+const SlotHeader* get_slot(const char* data, uint64_t frame_index)
+{
+    const SharedHeader* header = get_header(data);
+    const size_t slot = frame_index % header->num_slots;
+    return reinterpret_cast<const SlotHeader*>(
+        data + sizeof(SharedHeader) + slot * header->slot_stride);
+}
+}  // namespace
+
+SharedMemoryPublisher::SharedMemoryPublisher(const std::string& name,
+                                             uint32_t num_slots,
+                                             uint32_t max_frame_size,
+                                             bool take_over)
+    : shm_name_(get_shm_name(name)),
+      num_slots_(num_slots),
+      max_frame_size_(max_frame_size)
+{
+    if (num_slots == 0 || max_frame_size == 0)
+    {
+        throw std::invalid_argument(
+            "num_slots and max_frame_size must be greater than zero.");
+    }
+
+    // Never write to the memory of an existing publisher.  Instead, the old
+    // object is unlinked (if allowed) and a new one is created, so the
+    // layout can change and receivers that are still attached to the old one
+    // are not affected.
+    int fd = shm_open(shm_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1 && errno == EEXIST)
+    {
+        if (!take_over && !is_unused_segment(shm_name_))
+        {
+            throw std::runtime_error(fmt::format(
+                "Shared memory {} is already in use (is another publisher "
+                "running?).  Use take_over to replace it.",
+                shm_name_));
+        }
+        shm_unlink(shm_name_.c_str());
+        fd = shm_open(shm_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd == -1)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to create shared memory {}: {}",
+                        shm_name_,
+                        std::strerror(errno)));
+    }
+
+    const size_t slot_stride = get_slot_stride(max_frame_size);
+    size_ = sizeof(SharedHeader) + num_slots * slot_stride;
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) == 0 &&
+        ftruncate(fd, static_cast<off_t>(size_)) == 0)
+    {
+        shm_device_ = shm_stat.st_dev;
+        shm_inode_ = shm_stat.st_ino;
+        void* mapping =
+            mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            data_ = static_cast<char*>(mapping);
+        }
+    }
+    // the mapping stays valid after closing the file descriptor
+    ::close(fd);
+
+    if (!data_)
+    {
+        shm_unlink(shm_name_.c_str());
+        throw std::runtime_error(
+            fmt::format("Failed to map shared memory {}", shm_name_));
+    }
+
+    // memory of a new shared memory object is zero-initialised, so all slots
+    // are empty (sequence 0)
+    SharedHeader* header = new (data_) SharedHeader;
+    header->version = SHM_FORMAT_VERSION;
+    header->num_slots = num_slots;
+    header->max_frame_size = max_frame_size;
+    header->slot_stride = slot_stride;
+    header->publisher_pid = getpid();
+    header->num_published.store(0, std::memory_order_relaxed);
+    header->is_closed.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < num_slots; i++)
+    {
+        SlotHeader* slot = new (data_ + sizeof(SharedHeader) + i * slot_stride)
+            SlotHeader;
+        slot->sequence.store(0, std::memory_order_relaxed);
+    }
+    header->magic.store(SHM_MAGIC, std::memory_order_release);
+}
+
+SharedMemoryPublisher::~SharedMemoryPublisher()
+{
+    SharedHeader* header = reinterpret_cast<SharedHeader*>(data_);
+    header->is_closed.store(1, std::memory_order_release);
+    munmap(data_, size_);
+
+    // only remove the object if it was not taken over by another publisher in
+    // the meantime
+    int fd = shm_open(shm_name_.c_str(), O_RDONLY, 0);
+    if (fd != -1)
+    {
+        struct stat shm_stat;
+        if (fstat(fd, &shm_stat) == 0 && shm_stat.st_dev == shm_device_ &&
+            shm_stat.st_ino == shm_inode_)
+        {
+            shm_unlink(shm_name_.c_str());
+        }
+        ::close(fd);
+    }
+}
+
+void SharedMemoryPublisher::publish(const ViconFrame& frame)
+{
+    // encode each frame on its own, so readers can decode any of them
+    encoder_.reset();
+    buffer_.clear();
+    encoder_.encode(frame, buffer_);
+    if (buffer_.size() > max_frame_size_)
+    {
+        throw std::length_error(
+            fmt::format("Encoded frame has {} bytes but max_frame_size is {}.",
+                        buffer_.size(),
+                        max_frame_size_));
+    }
+
+    SharedHeader* header = reinterpret_cast<SharedHeader*>(data_);
+    SlotHeader* slot = reinterpret_cast<SlotHeader*>(
+        data_ + sizeof(SharedHeader) +
+        (num_published_ % num_slots_) * header->slot_stride);
+
+    slot->sequence.store(2 * num_published_ + 1, std::memory_order_relaxed);
+    // make sure the odd sequence is visible before any of the data changes
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->time_stamp.store(frame.time_stamp, std::memory_order_relaxed);
+    slot->frame_number.store(frame.frame_number, std::memory_order_relaxed);
+    slot->data_size.store(buffer_.size(), std::memory_order_relaxed);
+    copy_to_slot(get_slot_data(slot), buffer_.data(), buffer_.size());
+
+    slot->sequence.store(2 * num_published_ + 2, std::memory_order_release);
+    num_published_++;
+    header->num_published.store(num_published_, std::memory_order_release);
+}
+
+SharedMemoryReceiver::SharedMemoryReceiver(const std::string& name,
+                                           bool read_all_frames)
+    : shm_name_(get_shm_name(name)), read_all_frames_(read_all_frames)
+{
+    int fd = shm_open(shm_name_.c_str(), O_RDONLY, 0);
+    if (fd == -1)
+    {
+        throw std::runtime_error(fmt::format(
+            "Failed to open shared memory {} (is the publisher running?)",
+            shm_name_));
+    }
+
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) == 0 &&
+        static_cast<size_t>(shm_stat.st_size) >= sizeof(SharedHeader))
+    {
+        size_ = shm_stat.st_size;
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            data_ = static_cast<const char*>(mapping);
+        }
+    }
+    ::close(fd);
+
+    if (!data_)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to map shared memory {}", shm_name_));
+    }
+
+    const SharedHeader* header = get_header(data_);
+    std::string error;
+    if (header->magic.load(std::memory_order_acquire) != SHM_MAGIC)
+    {
+        error = fmt::format(
+            "Shared memory {} is not initialised or not a Vicon frame buffer.",
+            shm_name_);
+    }
+    else if (header->version != SHM_FORMAT_VERSION)
+    {
+        error = fmt::format(
+            "Unsupported shared memory format version {} (expected {})",
+            header->version,
+            SHM_FORMAT_VERSION);
+    }
+    else if (header->num_slots == 0 ||
+             header->slot_stride != get_slot_stride(header->max_frame_size) ||
+             size_ < sizeof(SharedHeader) +
+                         header->num_slots * header->slot_stride)
+    {
+        error = fmt::format("Shared memory {} has invalid size.", shm_name_);
+    }
+    if (!error.empty())
+    {
+        munmap(const_cast<char*>(data_), size_);
+        throw std::runtime_error(error);
+    }
+
+    buffer_.resize(header->max_frame_size);
+}
+
+SharedMemoryReceiver::~SharedMemoryReceiver()
+{
+    munmap(const_cast<char*>(data_), size_);
+}
+
+ViconFrame SharedMemoryReceiver::read()
+{
+    ViconFrame frame;
+    read_into(frame);
+    return frame;
+}
+
+void SharedMemoryReceiver::read_into(ViconFrame& frame)
+{
+    while (!try_read_into(frame))
+    {
+        const bool is_closed = is_publisher_closed();
+        if (is_closed || !is_publisher_alive())
+        {
+            // check again, in case the last frame was published just before
+            // closing
+            if (try_read_into(frame))
+            {
+                return;
+            }
+            throw std::runtime_error(
+                fmt::format(is_closed ? "Publisher of {} was closed."
+                                      : "Publisher of {} is not running.",
+                            shm_name_));
+        }
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+}
+
+bool SharedMemoryReceiver::try_read_into(ViconFrame& frame)
+{
+    const SharedHeader* header = get_header(data_);
+
+    // Retry as long as the slot is overwritten while reading it.  This only
+    // happens if the reader is slower than the publisher by a whole ring
+    // buffer, so in practice there are at most few iterations.
+    while (true)
+    {
+        const uint64_t num_published =
+            header->num_published.load(std::memory_order_acquire);
+        if (num_published == 0 || (has_read_ && next_frame_ >= num_published))
+        {
+            return false;
+        }
+
+        uint64_t frame_index;
+        if (!has_read_ || !read_all_frames_)
+        {
+            frame_index = num_published - 1;
+        }
+        else
+        {
+            // oldest frame that is not overwritten yet
+            const uint64_t oldest = num_published > header->num_slots
+                                        ? num_published - header->num_slots
+                                        : 0;
+            frame_index = std::max(next_frame_, oldest);
+        }
+
+        if (read_slot(frame_index, frame))
+        {
+            if (has_read_)
+            {
+                num_dropped_frames_ += frame_index - next_frame_;
+            }
+            has_read_ = true;
+            next_frame_ = frame_index + 1;
+            return true;
+        }
+    }
+}
+
+bool SharedMemoryReceiver::is_publisher_closed() const
+{
+    return get_header(data_)->is_closed.load(std::memory_order_acquire);
+}
+
+bool SharedMemoryReceiver::is_publisher_alive() const
+{
+    return is_process_alive(get_header(data_)->publisher_pid);
+}
+
+bool SharedMemoryReceiver::read_slot(uint64_t frame_index, ViconFrame& frame)
+{
+    const SlotHeader* slot = get_slot(data_, frame_index);
+
+    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence != 2 * frame_index + 2)
+    {
+        return false;
+    }
+
+    const int64_t time_stamp = slot->time_stamp.load(std::memory_order_relaxed);
+    const int64_t frame_number =
+        slot->frame_number.load(std::memory_order_relaxed);
+    const uint64_t data_size = slot->data_size.load(std::memory_order_relaxed);
+    if (data_size > buffer_.size())
+    {
+        // can only happen if the slot is being overwritten
+        return false;
+    }
+    copy_from_slot(buffer_.data(), get_slot_data(slot), data_size);
+
+    // make sure the data is read before checking the sequence again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != sequence)
+    {
+        return false;
+    }
+
+    // each frame is encoded on its own
+    decoder_.reset();
+    decoder_.decode(buffer_.data(), data_size, frame);
+    frame.time_stamp = time_stamp;
+    frame.frame_number = static_cast<int>(frame_number);
+    return true;
+}
+
+}  // namespace vicon_transformer
@@ -6,6 +6,25 @@
  */
 #include <vicon_transformer/types.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+//! Check if the frame contains exactly the given subjects (in that order).
+bool has_subjects(const vicon_transformer::ViconFrame& frame,
+                  const vicon_transformer::FlatViconFrame::NameTable& names)
+{
+    return frame.subjects.size() == names.size() &&
+           std::equal(frame.subjects.begin(),
+                      frame.subjects.end(),
+                      names.begin(),
+                      [](const auto& subject, const std::string& name)
+                      { return subject.first == name; });
+}
+}  // namespace
+
 namespace vicon_transformer
 {
 std::ostream& operator<<(std::ostream& os, const ViconFrame& vf)
@@ -35,4 +54,211 @@ std::ostream& operator<<(std::ostream& os, const ViconFrame& vf)
     return os;
 }
 
+void copy_frame(const ViconFrame& source, ViconFrame& target)
+{
+    target.frame_number = source.frame_number;
+    target.frame_rate = source.frame_rate;
+    target.latency = source.latency;
+    target.time_stamp = source.time_stamp;
+
+    // check if both frames have the same subjects (maps are sorted, so it is
+    // enough to compare the keys pairwise)
+    bool same_subjects =
+        source.subjects.size() == target.subjects.size() &&
+        std::equal(source.subjects.begin(),
+                   source.subjects.end(),
+                   target.subjects.begin(),
+                   [](const auto& a, const auto& b)
+                   { return a.first == b.first; });
+
+    if (same_subjects)
+    {
+        auto tgt_it = target.subjects.begin();
+        for (const auto& [_, data] : source.subjects)
+        {
+            (tgt_it++)->second = data;
+        }
+    }
+    else
+    {
+        target.subjects = source.subjects;
+    }
+}
+
+FlatViconFrame::FlatViconFrame(const ViconFrame& frame)
+{
+    assign(frame);
+}
+
+std::shared_ptr<const FlatViconFrame::NameTable>
+FlatViconFrame::empty_name_table()
+{
+    static const std::shared_ptr<const NameTable> empty =
+        std::make_shared<const NameTable>();
+    return empty;
+}
+
+std::optional<size_t> FlatViconFrame::find_subject(
+    const std::string& subject_name) const
+{
+    // names are sorted, so binary search can be used
+    auto it = std::lower_bound(
+        subject_names->begin(), subject_names->end(), subject_name);
+    if (it == subject_names->end() || *it != subject_name)
+    {
+        return std::nullopt;
+    }
+    return std::distance(subject_names->begin(), it);
+}
+
+void FlatViconFrame::assign(const ViconFrame& frame)
+{
+    frame_number = frame.frame_number;
+    frame_rate = frame.frame_rate;
+    latency = frame.latency;
+    time_stamp = frame.time_stamp;
+
+    bool same_subjects = has_subjects(frame, *subject_names);
+
+    if (!same_subjects)
+    {
+        auto names = std::make_shared<NameTable>();
+        names->reserve(frame.subjects.size());
+        for (const auto& [name, _] : frame.subjects)
+        {
+            names->push_back(name);
+        }
+        subject_names = names;
+    }
+
+    subjects.resize(frame.subjects.size());
+    size_t i = 0;
+    for (const auto& [_, data] : frame.subjects)
+    {
+        subjects[i++] = data;
+    }
+}
+
+void FlatViconFrame::to_vicon_frame(ViconFrame& frame) const
+{
+    // subjects can be modified from outside (e.g. from Python), so make sure
+    // it still matches the name table
+    if (subjects.size() != subject_names->size())
+    {
+        throw std::invalid_argument(
+            fmt::format("Frame has {} subjects but {} subject names.",
+                        subjects.size(),
+                        subject_names->size()));
+    }
+
+    frame.frame_number = frame_number;
+    frame.frame_rate = frame_rate;
+    frame.latency = latency;
+    frame.time_stamp = time_stamp;
+
+    bool same_subjects = has_subjects(frame, *subject_names);
+
+    if (same_subjects)
+    {
+        size_t i = 0;
+        for (auto& [_, data] : frame.subjects)
+        {
+            data = subjects[i++];
+        }
+    }
+    else
+    {
+        frame.subjects.clear();
+        for (size_t i = 0; i < subjects.size(); i++)
+        {
+            // names are sorted, so always insert at the end
+            frame.subjects.emplace_hint(
+                frame.subjects.end(), (*subject_names)[i], subjects[i]);
+        }
+    }
+}
+
+ViconFrame FlatViconFrame::to_vicon_frame() const
+{
+    ViconFrame frame;
+    to_vicon_frame(frame);
+    return frame;
+}
+
+SubjectPoses::SubjectPoses(const ViconFrame& frame)
+{
+    resize(frame.subjects.size());
+    names.reserve(frame.subjects.size());
+    size_t i = 0;
+    for (const auto& [name, subject] : frame.subjects)
+    {
+        names.push_back(name);
+        set(i++, subject.is_visible, subject.global_pose);
+    }
+}
+
+SubjectPoses::SubjectPoses(const FlatViconFrame& frame)
+    : names(*frame.subject_names)
+{
+    resize(frame.num_subjects());
+    for (size_t i = 0; i < frame.num_subjects(); i++)
+    {
+        set(i, frame.subjects[i].is_visible, frame.subjects[i].global_pose);
+    }
+}
+
+void SubjectPoses::resize(size_t num_subjects)
+{
+    poses.resize(num_subjects, Eigen::NoChange);
+    is_visible.resize(num_subjects);
+}
+
+void SubjectPoses::set(size_t index,
+                       bool visible,
+                       const spatial_transformation::Transformation& pose)
+{
+    is_visible[index] = visible;
+    if (visible)
+    {
+        poses.row(index) << pose.translation.transpose(),
+            pose.rotation.coeffs().transpose();
+    }
+    else
+    {
+        poses.row(index).setConstant(
+            std::numeric_limits<double>::quiet_NaN());
+    }
+}
+
+PackedSubjectData::PackedSubjectData(const SubjectData& subject)
+{
+    // invisible subjects are zeroed, as their values are undefined
+    if (subject.is_visible)
+    {
+        const auto& pose = subject.global_pose;
+        translation = {
+            pose.translation.x(), pose.translation.y(), pose.translation.z()};
+        rotation = {pose.rotation.x(),
+                    pose.rotation.y(),
+                    pose.rotation.z(),
+                    pose.rotation.w()};
+        quality = subject.quality;
+        is_visible = 1;
+    }
+}
+
+SubjectData PackedSubjectData::unpack() const
+{
+    SubjectData subject;
+    subject.is_visible = is_visible != 0;
+    subject.global_pose.translation =
+        Eigen::Vector3d(translation[0], translation[1], translation[2]);
+    subject.global_pose.rotation.x() = rotation[0];
+    subject.global_pose.rotation.y() = rotation[1];
+    subject.global_pose.rotation.z() = rotation[2];
+    subject.global_pose.rotation.w() = rotation[3];
+    subject.quality = quality;
+    return subject;
+}
+
 }  // namespace vicon_transformer
@@ -53,6 +53,8 @@ public:
     bool lightweight = false;
     int num_frames = 0;
     bool json_output = false;
+    double playback_speed = 0.0;
+    bool rewrite_time_stamps = false;
     std::vector<std::string> filtered_subjects;
 
     std::string help() const override
@@ -84,6 +86,11 @@ Usage:  vicon_print_data <vicon-host-name-or-file> [options]
              "Only print the specified number of frames.")
             ("json",
              "Produce JSON-formatted output.")
+            ("speed",
+             po::value<double>(&playback_speed),
+             "When playing back a file: Speed factor relative to the recording rate (e.g. 1 for real time), in the range [0.1, 100].  Default: 0 (as fast as possible).")
+            ("now",
+             "When playing back a file: Replace time stamps with the current time.")
             ;
         // clang-format on
 
@@ -95,6 +102,7 @@ Usage:  vicon_print_data <vicon-host-name-or-file> [options]
     {
         lightweight = args.count("lightweight") > 0;
         json_output = args.count("json") > 0;
+        rewrite_time_stamps = args.count("now") > 0;
     }
 };
 }  // namespace
@@ -116,6 +124,21 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    // validate here, so an invalid value is reported as a usage error instead
+    // of aborting with an uncaught exception from set_playback_speed()
+    using vicon_transformer::PlaybackReceiver;
+    if (args.playback_speed != 0.0 &&
+        !(args.playback_speed >= PlaybackReceiver::MIN_PLAYBACK_SPEED &&
+          args.playback_speed <= PlaybackReceiver::MAX_PLAYBACK_SPEED))
+    {
+        logger->error("Invalid value {} for --speed.  Expected 0 or a value in "
+                      "[{}, {}].",
+                      args.playback_speed,
+                      PlaybackReceiver::MIN_PLAYBACK_SPEED,
+                      PlaybackReceiver::MAX_PLAYBACK_SPEED);
+        return 1;
+    }
+
     std::unique_ptr<vicon_transformer::Receiver> receiver;
 
     // if the argument is an existing file, load it for playback, otherwise
@@ -135,12 +158,22 @@ int main(int argc, char *argv[])
             static_cast<vicon_transformer::ViconReceiver *>(receiver.get());
         ptr->connect();
         ptr->print_info();
+
+        if (args.playback_speed != 0.0 || args.rewrite_time_stamps)
+        {
+            logger->warn(
+                "Arguments --speed and --now are ignored when connecting to "
+                "Vicon.");
+        }
     }
     else
     {
         // argument is a recorded file
-        receiver = std::make_unique<vicon_transformer::PlaybackReceiver>(
+        auto playback = std::make_unique<vicon_transformer::PlaybackReceiver>(
             args.host_or_file, logger);
+        playback->set_playback_speed(args.playback_speed);
+        playback->set_rewrite_time_stamps(args.rewrite_time_stamps);
+        receiver = std::move(playback);
 
         if (args.lightweight)
         {
@@ -3,7 +3,9 @@
 #include <vicon_transformer/vicon_receiver.hpp>
 
 #include <unistd.h>
+#include <algorithm>
 #include <fstream>
+#include <stdexcept>
 
 #include <fmt/format.h>
 #include <fmt/ostream.h>
@@ -50,6 +52,9 @@ ViconReceiver::~ViconReceiver()
     {
         disconnect();
     }
+    // In case the acquisition thread terminated on its own (e.g. due to lost
+    // connection), it still needs to be joined.
+    stop_acquisition_thread();
 }
 
 bool ViconReceiver::is_connected() const
@@ -60,6 +65,7 @@ bool ViconReceiver::is_connected() const
 void ViconReceiver::connect()
 {
     log_->info("Connecting to {}...", host_name_);
+    subject_cache_.clear();
     while (!client_.IsConnected().Connected)
     {
         // Direct connection
@@ -116,10 +122,17 @@ void ViconReceiver::connect()
     {
         filter_subjects(config_.filtered_subjects);
     }
+
+    if (config_.use_acquisition_thread)
+    {
+        start_acquisition_thread();
+    }
 }
 
 void ViconReceiver::disconnect()
 {
+    stop_acquisition_thread();
+
     log_->info("Disconnecting...");
     client_.DisableSegmentData();
     client_.Disconnect();
@@ -162,7 +175,49 @@ void ViconReceiver::print_info() const
 ViconFrame ViconReceiver::read()
 {
     ViconFrame frame;
+    read_into(frame);
+    return frame;
+}
+
+void ViconReceiver::read_into(ViconFrame& frame)
+{
+    if (!acquisition_running_)
+    {
+        receive_frame(frame);
+        return;
+    }
+
+    if (!latest_frame_.has_new_data())
+    {
+        std::unique_lock<std::mutex> lock(new_frame_mutex_);
+        new_frame_cond_.wait(lock,
+                             [this]
+                             {
+                                 return latest_frame_.has_new_data() ||
+                                        acquisition_error_ ||
+                                        stop_acquisition_;
+                             });
+
+        if (!latest_frame_.has_new_data())
+        {
+            // if the acquisition thread died, forward its exception
+            if (acquisition_error_)
+            {
+                std::rethrow_exception(acquisition_error_);
+            }
+            // The thread is only stopped when disconnecting.  Receiving
+            // directly is not an option here, as the thread may still be
+            // using the client.
+            throw NotConnectedError();
+        }
+    }
+
+    latest_frame_.swap();
+    copy_frame(latest_frame_.read_buffer(), frame);
+}
 
+void ViconReceiver::receive_frame(ViconFrame& frame)
+{
     client_get_frame();
 
     // NOTE: This is only guaranteed to provide a UNIX timestamp
@@ -178,21 +233,73 @@ ViconFrame ViconReceiver::read()
     frame.frame_rate = client_.GetFrameRate().FrameRateHz;
     frame.latency = client_.GetLatencyTotal().Total;
 
-    // Count the number of subjects
+    // The subject list rarely changes, so names and root segments are cached
+    // and only looked up again if the number of subjects changes or the cached
+    // names turn out to be invalid.
     unsigned int subject_count = client_.GetSubjectCount().SubjectCount;
-    for (unsigned int i = 0; i < subject_count; ++i)
+    if (subject_count != subject_cache_.size())
     {
-        SubjectData subject_data;
+        update_subject_cache(subject_count);
+    }
+    prepare_subjects(frame);
+    if (!read_subjects(frame))
+    {
+        update_subject_cache(subject_count);
+        prepare_subjects(frame);
+        if (!read_subjects(frame))
+        {
+            // the cache was just updated based on the same frame, so this
+            // should not happen
+            throw BadResultError(Result::InvalidSubjectName);
+        }
+    }
+}
 
-        std::string subject_name = client_.GetSubjectName(i).SubjectName;
+void ViconReceiver::prepare_subjects(ViconFrame& frame) const
+{
+    // Usually the frame already contains the subjects of the previous frame,
+    // so this only compares the names.
+    const bool same_subjects =
+        frame.subjects.size() == subject_cache_.size() &&
+        std::equal(subject_cache_.begin(),
+                   subject_cache_.end(),
+                   frame.subjects.begin(),
+                   [](const SubjectInfo& subject, const auto& entry)
+                   { return subject.name == entry.first; });
+    if (same_subjects)
+    {
+        return;
+    }
+
+    frame.subjects.clear();
+    for (const SubjectInfo& subject : subject_cache_)
+    {
+        // names are sorted, so each subject is inserted at the end
+        frame.subjects.emplace_hint(
+            frame.subjects.end(), subject.name, SubjectData());
+    }
+}
+
+bool ViconReceiver::read_subjects(ViconFrame& frame)
+{
+    // prepare_subjects() made sure that the subjects of the frame are the same
+    // as in the cache, in the same order, so no lookup by name is needed
+    auto frame_subject = frame.subjects.begin();
+    for (const SubjectInfo& subject : subject_cache_)
+    {
+        SubjectData& subject_data = (frame_subject++)->second;
 
         // only get pose of root segment
-        std::string root_segment =
-            client_.GetSubjectRootSegmentName(subject_name).SegmentName;
-        auto global_translation =
-            client_.GetSegmentGlobalTranslation(subject_name, root_segment);
+        auto global_translation = client_.GetSegmentGlobalTranslation(
+            subject.sdk_name, subject.sdk_root_segment);
+        if (global_translation.Result == Result::InvalidSubjectName ||
+            global_translation.Result == Result::InvalidSegmentName)
+        {
+            // subject list changed
+            return false;
+        }
         auto global_rotation = client_.GetSegmentGlobalRotationQuaternion(
-            subject_name, root_segment);
+            subject.sdk_name, subject.sdk_root_segment);
 
         subject_data.is_visible =
             !(global_translation.Occluded or global_rotation.Occluded);
@@ -214,15 +321,44 @@ ViconFrame ViconReceiver::read()
                 spatial_transformation::Transformation(rotation, translation);
 
             // Get the quality of the subject (object) if supported
-            auto quality = client_.GetObjectQuality(subject_name);
+            auto quality = client_.GetObjectQuality(subject.sdk_name);
             subject_data.quality =
                 (quality.Result == Result::Success) ? quality.Quality : 0.0;
         }
+    }
+
+    return true;
+}
+
+void ViconReceiver::update_subject_cache(unsigned int subject_count)
+{
+    log_->debug("Update subject list ({} subjects)", subject_count);
 
-        frame.subjects[subject_name] = subject_data;
+    subject_cache_.clear();
+    subject_cache_.reserve(subject_count);
+    for (unsigned int i = 0; i < subject_count; ++i)
+    {
+        SubjectInfo subject;
+        subject.name = client_.GetSubjectName(i).SubjectName;
+        subject.sdk_name = subject.name;
+        subject.sdk_root_segment =
+            client_.GetSubjectRootSegmentName(subject.sdk_name).SegmentName;
+
+        subject_cache_.push_back(std::move(subject));
     }
 
-    return frame;
+    // same order as in ViconFrame::subjects (see prepare_subjects()), which
+    // cannot contain duplicate names
+    std::sort(subject_cache_.begin(),
+              subject_cache_.end(),
+              [](const SubjectInfo& a, const SubjectInfo& b)
+              { return a.name < b.name; });
+    subject_cache_.erase(
+        std::unique(subject_cache_.begin(),
+                    subject_cache_.end(),
+                    [](const SubjectInfo& a, const SubjectInfo& b)
+                    { return a.name == b.name; }),
+        subject_cache_.end());
 }
 
 void ViconReceiver::print_latency_info() const
@@ -268,6 +404,67 @@ void ViconReceiver::filter_subjects(const std::vector<std::string>& subjects)
     }
 }
 
+void ViconReceiver::start_acquisition_thread()
+{
+    if (acquisition_thread_.joinable())
+    {
+        return;
+    }
+
+    log_->info("Start acquisition thread.");
+    stop_acquisition_ = false;
+    acquisition_error_ = nullptr;
+    acquisition_running_ = true;
+    acquisition_thread_ = std::thread(&ViconReceiver::acquisition_loop, this);
+}
+
+void ViconReceiver::stop_acquisition_thread()
+{
+    if (!acquisition_thread_.joinable())
+    {
+        return;
+    }
+
+    log_->info("Stop acquisition thread.");
+    {
+        // set under the mutex, so waiting readers cannot miss the notification
+        std::lock_guard<std::mutex> lock(new_frame_mutex_);
+        stop_acquisition_ = true;
+    }
+    new_frame_cond_.notify_all();
+    acquisition_thread_.join();
+    acquisition_running_ = false;
+}
+
+void ViconReceiver::acquisition_loop()
+{
+    try
+    {
+        while (!stop_acquisition_)
+        {
+            receive_frame(latest_frame_.write_buffer());
+            latest_frame_.publish();
+
+            // Lock the mutex between publishing and notifying, so a reader
+            // cannot miss the notification between checking for new data and
+            // starting to wait.
+            {
+                std::lock_guard<std::mutex> lock(new_frame_mutex_);
+            }
+            new_frame_cond_.notify_one();
+        }
+    }
+    catch (...)
+    {
+        log_->error("Acquisition thread terminated due to an error.");
+        {
+            std::lock_guard<std::mutex> lock(new_frame_mutex_);
+            acquisition_error_ = std::current_exception();
+        }
+        new_frame_cond_.notify_all();
+    }
+}
+
 void ViconReceiver::client_get_frame()
 {
     Result result = client_.GetFrame().Result;
@@ -300,6 +497,11 @@ ViconFrame JsonReceiver::read()
     return frame_;
 }
 
+void JsonReceiver::read_into(ViconFrame& frame)
+{
+    copy_frame(frame_, frame);
+}
+
 PlaybackReceiver::PlaybackReceiver(const std::filesystem::path& filename,
                                    std::shared_ptr<spdlog::logger> logger)
 {
@@ -318,14 +520,25 @@ PlaybackReceiver::PlaybackReceiver(const std::filesystem::path& filename,
 
     log_->info("Load Vicon data from file {}", filename);
 
-    std::ifstream file(filename);
-    if (!file.is_open())
+    if (is_recording_file(filename))
     {
-        throw std::runtime_error(
-            fmt::format("Failed to open file {}", filename));
+        recording_ = std::make_unique<RecordingReader>(filename);
+        if (!recording_->has_index())
+        {
+            log_->warn(
+                "Recording has no index (was the recording aborted?).  Only "
+                "complete chunks are loaded.");
+        }
     }
-
+    else
     {
+        std::ifstream file(filename);
+        if (!file.is_open())
+        {
+            throw std::runtime_error(
+                fmt::format("Failed to open file {}", filename));
+        }
+
         cereal::BinaryInputArchive archive(file);
         archive(tape_);
     }
@@ -334,7 +547,156 @@ PlaybackReceiver::PlaybackReceiver(const std::filesystem::path& filename,
 
 ViconFrame PlaybackReceiver::read()
 {
-    return tape_.at(tape_index_++);
+    ViconFrame frame;
+    read_into(frame);
+    return frame;
+}
+
+void PlaybackReceiver::read_into(ViconFrame& frame)
+{
+    if (recording_)
+    {
+        recording_->read_frame(tape_index_, frame);
+    }
+    else
+    {
+        copy_frame(tape_.at(tape_index_), frame);
+    }
+    tape_index_++;
+
+    if (playback_speed_ > 0.0)
+    {
+        wait_for_playback_time(frame.time_stamp);
+    }
+    if (rewrite_time_stamps_)
+    {
+        frame.time_stamp =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count();
+    }
+}
+
+size_t PlaybackReceiver::num_frames() const
+{
+    return recording_ ? recording_->num_frames() : tape_.size();
+}
+
+void PlaybackReceiver::seek_to_frame(int frame_number)
+{
+    size_t index;
+    if (recording_)
+    {
+        index = recording_->find_frame_number(frame_number);
+    }
+    else
+    {
+        auto it = std::partition_point(
+            tape_.begin(),
+            tape_.end(),
+            [frame_number](const ViconFrame& frame)
+            { return frame.frame_number < frame_number; });
+        index = std::distance(tape_.begin(), it);
+    }
+
+    if (index >= num_frames())
+    {
+        throw std::out_of_range(fmt::format(
+            "Frame number {} is after the end of the recording.",
+            frame_number));
+    }
+    tape_index_ = index;
+    pacing_started_ = false;
+}
+
+void PlaybackReceiver::seek_to_time(int64_t time_stamp_ns)
+{
+    size_t index = find_time_stamp(time_stamp_ns);
+    if (index >= num_frames())
+    {
+        throw std::out_of_range(
+            fmt::format("Time stamp {} is after the end of the recording.",
+                        time_stamp_ns));
+    }
+    tape_index_ = index;
+    pacing_started_ = false;
+}
+
+std::vector<ViconFrame> PlaybackReceiver::read_range(
+    int64_t start_time_stamp_ns, int64_t end_time_stamp_ns)
+{
+    const size_t begin = find_time_stamp(start_time_stamp_ns);
+    const size_t end = find_time_stamp(end_time_stamp_ns);
+
+    std::vector<ViconFrame> frames;
+    if (end <= begin)
+    {
+        return frames;
+    }
+
+    frames.resize(end - begin);
+    for (size_t i = begin; i < end; i++)
+    {
+        if (recording_)
+        {
+            recording_->read_frame(i, frames[i - begin]);
+        }
+        else
+        {
+            frames[i - begin] = tape_[i];
+        }
+    }
+    return frames;
+}
+
+void PlaybackReceiver::set_playback_speed(double speed)
+{
+    if (speed != 0.0 &&
+        !(speed >= MIN_PLAYBACK_SPEED && speed <= MAX_PLAYBACK_SPEED))
+    {
+        throw std::invalid_argument(
+            fmt::format("Invalid playback speed {}.  Expected 0 or a value in "
+                        "[{}, {}].",
+                        speed,
+                        MIN_PLAYBACK_SPEED,
+                        MAX_PLAYBACK_SPEED));
+    }
+    playback_speed_ = speed;
+    pacing_started_ = false;
+}
+
+void PlaybackReceiver::wait_for_playback_time(int64_t time_stamp_ns)
+{
+    // restart if time goes backwards (e.g. recording was concatenated)
+    if (!pacing_started_ || time_stamp_ns < pacing_start_time_stamp_)
+    {
+        pacing_started_ = true;
+        pacing_start_time_ = std::chrono::steady_clock::now();
+        pacing_start_time_stamp_ = time_stamp_ns;
+        return;
+    }
+
+    const double elapsed_ns =
+        static_cast<double>(time_stamp_ns - pacing_start_time_stamp_) /
+        playback_speed_;
+    std::this_thread::sleep_until(
+        pacing_start_time_ +
+        std::chrono::nanoseconds(static_cast<int64_t>(elapsed_ns)));
+}
+
+size_t PlaybackReceiver::find_time_stamp(int64_t time_stamp_ns)
+{
+    if (recording_)
+    {
+        return recording_->find_time_stamp(time_stamp_ns);
+    }
+
+    auto it = std::partition_point(
+        tape_.begin(),
+        tape_.end(),
+        [time_stamp_ns](const ViconFrame& frame)
+        { return frame.time_stamp < time_stamp_ns; });
+    return std::distance(tape_.begin(), it);
 }
 
 }  // namespace vicon_transformer
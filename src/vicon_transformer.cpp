@@ -46,18 +46,141 @@ std::shared_ptr<const Receiver> ViconTransformer::receiver() const
 
 void ViconTransformer::update()
 {
-    set_frame(receiver_->read());
+    read_frame();
+    process_frame();
 }
 
 void ViconTransformer::set_frame(const ViconFrame &frame)
 {
-    frame_ = frame;
+    frame_.assign(frame);
+    process_frame();
+}
+
+void ViconTransformer::read_frame()
+{
+    receiver_->read_into(received_frame_);
+    frame_.assign(received_frame_);
+}
+
+bool ViconTransformer::try_process_frame()
+{
+    bool origin_available = true;
 
     // TODO: should this be updated for every frame or only once in the
     // beginning?
     if (!origin_subject_name_.empty())
     {
-        origin_tf_ = get_raw_transform(origin_subject_name_).inverse();
+        std::optional<Transformation> origin_pose =
+            try_get_raw_transform(origin_subject_name_);
+        if (origin_pose)
+        {
+            origin_tf_ = origin_pose->inverse();
+        }
+        else
+        {
+            origin_available = false;
+        }
+    }
+
+    // Apply the origin transform to all subjects in one batch (about twice as
+    // fast per pose as transforming them one by one, including the conversion
+    // to/from PoseArray).  This is done here, so that the const getters only
+    // read and can safely be called concurrently.
+    transform_all_poses();
+
+    if (origin_available && history_.capacity() > 0)
+    {
+        if (history_.size() > 0 &&
+            frame_.time_stamp <= history_.newest_time_stamp())
+        {
+            history_.clear();
+        }
+        // write directly to the history storage to reuse its memory
+        FlatViconFrame &entry = history_.push();
+        entry = frame_;
+        transformed_poses_.scatter_visible(entry.subjects);
+    }
+
+    if (latency_compensation_)
+    {
+        predict_poses();
+    }
+
+    return origin_available;
+}
+
+void ViconTransformer::predict_poses()
+{
+    const size_t num_subjects = frame_.num_subjects();
+
+    // Use the frame numbers to determine the time between the frames, as they
+    // are based on the capture time, while the time stamps are based on the
+    // time of reception and thus have some jitter.
+    double factor = 0.0;
+    if (previous_subject_names_ == frame_.subject_names &&
+        frame_.frame_number > previous_frame_number_ && frame_.frame_rate > 0)
+    {
+        const double dt = (frame_.frame_number - previous_frame_number_) /
+                          frame_.frame_rate;
+        factor = (frame_.latency + latency_offset_s_) / dt;
+
+        // subjects that are not visible in both frames are not extrapolated
+        for (size_t i = 0; i < num_subjects; i++)
+        {
+            if (!previous_visible_[i] || !frame_.subjects[i].is_visible)
+            {
+                previous_poses_.set(i, transformed_poses_.get(i));
+            }
+        }
+    }
+    else
+    {
+        previous_poses_ = transformed_poses_;
+    }
+
+    extrapolate_poses(
+        previous_poses_, transformed_poses_, factor, predicted_poses_);
+
+    // keep the current poses for the next prediction
+    previous_poses_ = transformed_poses_;
+    previous_subject_names_ = frame_.subject_names;
+    previous_frame_number_ = frame_.frame_number;
+    previous_visible_.resize(num_subjects);
+    for (size_t i = 0; i < num_subjects; i++)
+    {
+        previous_visible_[i] = frame_.subjects[i].is_visible;
+    }
+}
+
+void ViconTransformer::transform_all_poses()
+{
+    raw_poses_.gather(frame_.subjects);
+    transform_poses(origin_tf_, raw_poses_, transformed_poses_);
+}
+
+const PoseArray &ViconTransformer::output_poses() const
+{
+    if (latency_compensation_)
+    {
+        return predicted_poses_;
+    }
+    return transformed_poses_;
+}
+
+Transformation ViconTransformer::get_output_pose(size_t index) const
+{
+    return output_poses().get(index);
+}
+
+void ViconTransformer::process_frame()
+{
+    if (!try_process_frame())
+    {
+        if (!frame_.find_subject(origin_subject_name_))
+        {
+            throw UnknownSubjectError(origin_subject_name_);
+        }
+        throw SubjectNotVisibleError(origin_subject_name_);
     }
 }
 
@@ -74,16 +197,15 @@ void ViconTransformer::wait_for_origin_subject_data()
     while (true)
     {
         log_->debug("get new frame");
-        try
+        read_frame();
+        if (try_process_frame())
         {
-            update();
             log_->info("Got origin subject pose.");
-            // break loop if update was successful
             break;
         }
-        catch (const SubjectNotVisibleError &)
+        if (!frame_.find_subject(origin_subject_name_))
         {
-            // do nothing
+            throw UnknownSubjectError(origin_subject_name_);
         }
     }
 }
@@ -95,86 +217,244 @@ int64_t ViconTransformer::get_timestamp_ns() const
 
 std::vector<std::string> ViconTransformer::get_subject_names() const
 {
-    std::vector<std::string> names;
-    names.reserve(frame_.subjects.size());
-    for (const auto &[name, _] : frame_.subjects)
+    return *frame_.subject_names;
+}
+
+std::shared_ptr<const FlatViconFrame::NameTable>
+ViconTransformer::get_subject_name_table() const noexcept
+{
+    return frame_.subject_names;
+}
+
+SubjectHandle ViconTransformer::resolve(const std::string &subject_name) const
+{
+    std::optional<size_t> index = frame_.find_subject(subject_name);
+    if (!index)
     {
-        names.push_back(name);
+        throw UnknownSubjectError(subject_name);
     }
-    return names;
+    return SubjectHandle(frame_.subject_names, *index);
+}
+
+bool ViconTransformer::is_valid(const SubjectHandle &subject) const noexcept
+{
+    // The name table is shared between all frames with the same subjects, so
+    // comparing the pointers is enough.  The handle keeps the table alive, so
+    // its address cannot be reused by a new table.
+    return subject.name_table_ == frame_.subject_names;
 }
 
 bool ViconTransformer::is_visible(const std::string &subject_name) const
 {
-    try
-    {
-        return get_subject_data(subject_name).is_visible;
-    }
-    catch (const std::out_of_range &)
+    return get_subject_data(subject_name).is_visible;
+}
+
+bool ViconTransformer::is_visible(const SubjectHandle &subject) const noexcept
+{
+    return is_valid(subject) && frame_.subjects[subject.index_].is_visible;
+}
+
+Transformation ViconTransformer::get_transform(
+    const std::string &subject_name) const
+{
+    // throws if the subject is not available
+    Transformation raw_tf = get_raw_transform(subject_name);
+
+    if (latency_compensation_)
     {
-        throw UnknownSubjectError(subject_name);
+        return *try_get_transform(subject_name);
     }
+    return origin_tf_ * raw_tf;
 }
 
 Transformation ViconTransformer::get_transform(
+    const SubjectHandle &subject) const noexcept
+{
+    // If subject is not visible, its pose should be set to identity.
+    // Applying the origin transform would result in something that looks
+    // like a legit pose while it is actually just garbage.  Thus simply
+    // return the identity pose instead, which makes it more obvious that
+    // the subject is not actually visible when looking at the data.
+    return try_get_transform(subject).value_or(Transformation::Identity());
+}
+
+Transformation ViconTransformer::get_raw_transform(
     const std::string &subject_name) const
 {
-    auto tf = get_raw_transform(subject_name);
-    if (is_visible(subject_name))
+    std::optional<Transformation> tf = try_get_raw_transform(subject_name);
+    if (!tf)
     {
-        return origin_tf_ * tf;
+        // throws UnknownSubjectError if the subject does not exist at all
+        get_subject_data(subject_name);
+        throw SubjectNotVisibleError(subject_name);
     }
-    else
+
+    return *tf;
+}
+
+Transformation ViconTransformer::get_raw_transform(
+    const SubjectHandle &subject) const noexcept
+{
+    return try_get_raw_transform(subject).value_or(Transformation::Identity());
+}
+
+std::optional<Transformation> ViconTransformer::try_get_transform(
+    const std::string &subject_name) const noexcept
+{
+    std::optional<size_t> index = frame_.find_subject(subject_name);
+    if (!index || !frame_.subjects[*index].is_visible)
     {
-        // If subject is not visible, its pose should be set to identity.
-        // Applying the origin transform would result in something that looks
-        // like a legit pose while it is actually just garbage.  Thus simply
-        // forward the identity pose instead, which makes it more obvious that
-        // the subject is not actually visible when looking at the data.
-        return tf;
+        return std::nullopt;
     }
+    return get_output_pose(*index);
 }
 
-Transformation ViconTransformer::get_raw_transform(
-    const std::string &subject_name) const
+std::optional<Transformation> ViconTransformer::try_get_transform(
+    const SubjectHandle &subject) const noexcept
 {
-    SubjectData sd = get_subject_data(subject_name);
+    if (!is_visible(subject))
+    {
+        return std::nullopt;
+    }
+    return get_output_pose(subject.index_);
+}
 
-    if (!sd.is_visible)
+std::optional<Transformation> ViconTransformer::try_get_raw_transform(
+    const std::string &subject_name) const noexcept
+{
+    std::optional<size_t> index = frame_.find_subject(subject_name);
+    if (!index || !frame_.subjects[*index].is_visible)
     {
-        throw SubjectNotVisibleError(subject_name);
+        return std::nullopt;
     }
+    return frame_.subjects[*index].global_pose;
+}
 
-    return sd.global_pose;
+std::optional<Transformation> ViconTransformer::try_get_raw_transform(
+    const SubjectHandle &subject) const noexcept
+{
+    if (!is_visible(subject))
+    {
+        return std::nullopt;
+    }
+    return frame_.subjects[subject.index_].global_pose;
 }
 
 const SubjectData &ViconTransformer::get_subject_data(
     const std::string &subject_name) const
 {
-    try
-    {
-        return frame_.subjects.at(subject_name);
-    }
-    catch (const std::out_of_range &)
+    std::optional<size_t> index = frame_.find_subject(subject_name);
+    if (!index)
     {
         throw UnknownSubjectError(subject_name);
     }
+    return frame_.subjects[*index];
 }
 
 ViconFrame ViconTransformer::get_frame() const
 {
-    ViconFrame transformed_frame = frame_;
+    ViconFrame transformed_frame;
+    get_frame_into(transformed_frame);
+    return transformed_frame;
+}
+
+void ViconTransformer::get_frame_into(ViconFrame &frame) const
+{
+    frame_.to_vicon_frame(frame);
 
-    for (auto &[name, data] : transformed_frame.subjects)
+    // subjects in the map have the same order as in the flat frame
+    const PoseArray &poses = output_poses();
+    size_t i = 0;
+    for (auto &[_, data] : frame.subjects)
     {
         // only apply origin transform if the subject is actually visible
         if (data.is_visible)
         {
-            data.global_pose = origin_tf_ * data.global_pose;
+            data.global_pose = poses.get(i);
         }
+        i++;
     }
+}
 
+FlatViconFrame ViconTransformer::get_flat_frame() const
+{
+    FlatViconFrame transformed_frame;
+    get_frame_into(transformed_frame);
     return transformed_frame;
 }
 
+void ViconTransformer::get_frame_into(FlatViconFrame &frame) const
+{
+    frame = frame_;
+
+    // Only apply origin transform if the subject is actually visible.  If it
+    // is not visible, its pose is garbage and applying the origin transform
+    // would result in something that looks like a legit pose.
+    output_poses().scatter_visible(frame.subjects);
+}
+
+SubjectPoses ViconTransformer::get_all_transforms() const
+{
+    SubjectPoses poses;
+    get_all_transforms_into(poses);
+    return poses;
+}
+
+void ViconTransformer::get_all_transforms_into(SubjectPoses &poses) const
+{
+    poses.names = *frame_.subject_names;
+    poses.resize(frame_.num_subjects());
+    const PoseArray &output = output_poses();
+    for (size_t i = 0; i < frame_.num_subjects(); i++)
+    {
+        poses.set(i, frame_.subjects[i].is_visible, output.get(i));
+    }
+}
+
+void ViconTransformer::set_latency_compensation(bool enable,
+                                                double additional_offset_s)
+{
+    latency_compensation_ = enable;
+    latency_offset_s_ = additional_offset_s;
+
+    // start without prediction until the next frame is processed
+    if (enable)
+    {
+        predicted_poses_ = transformed_poses_;
+    }
+    previous_subject_names_ = nullptr;
+}
+
+bool ViconTransformer::is_latency_compensation_enabled() const
+{
+    return latency_compensation_;
+}
+
+void ViconTransformer::set_history_size(size_t num_frames)
+{
+    history_.set_capacity(num_frames);
+}
+
+size_t ViconTransformer::get_history_size() const
+{
+    return history_.capacity();
+}
+
+std::optional<Transformation> ViconTransformer::get_transform_at(
+    const std::string &subject_name, int64_t time_stamp_ns) const noexcept
+{
+    return history_.get_pose_at(subject_name, time_stamp_ns);
+}
+
+std::optional<Transformation> ViconTransformer::get_transform_at(
+    const SubjectHandle &subject, int64_t time_stamp_ns) const noexcept
+{
+    if (!subject.name_table_)
+    {
+        return std::nullopt;
+    }
+    return history_.get_pose_at(
+        *subject.name_table_, subject.index_, time_stamp_ns);
+}
+
 }  // namespace vicon_transformer
@@ -4,21 +4,116 @@
  * @file Python bindings of the relevant C++ classes/functions.
  * @copyright 2022, Max Planck Gesellschaft.  All rights reserved.
  */
+#include <limits>
 #include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
 
 #include <pybind11/eigen.h>
+#include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl/filesystem.h>
 
+#include <o80/front_end.hpp>
 #include <serialization_utils/cereal_json.hpp>
 
+#include <vicon_transformer/columnar_recording.hpp>
 #include <vicon_transformer/errors.hpp>
+#include <vicon_transformer/o80_standalone.hpp>
+#include <vicon_transformer/pybind11_helper.hpp>
+#include <vicon_transformer/recording.hpp>
+#include <vicon_transformer/shared_memory_broadcast.hpp>
 #include <vicon_transformer/types.hpp>
 #include <vicon_transformer/vicon_receiver.hpp>
 #include <vicon_transformer/vicon_transformer.hpp>
 
+namespace
+{
+namespace py = pybind11;
+
+/**
+ * @brief Create a read-only numpy array that refers to the given data without
+ * copying it.
+ *
+ * @param base Python object that owns the data.  It is kept alive as long as
+ *      the array exists.
+ */
+template <typename T>
+py::array_t<T> make_readonly_array(std::vector<py::ssize_t> shape,
+                                   const T* data,
+                                   py::handle base)
+{
+    py::array_t<T> array(shape, data, base);
+    array.attr("setflags")(py::arg("write") = false);
+    return array;
+}
+
+/**
+ * @brief Move a vector into a numpy array without copying the data.
+ *
+ * The vector is moved to the heap and owned by the array.  Optionally, the
+ * elements can be interpreted as a different type of the same size (e.g.
+ * uint8_t as bool).
+ */
+template <typename T, typename ArrayType = T>
+py::array_t<ArrayType> vector_to_array(std::vector<T>&& vector,
+                                       std::vector<py::ssize_t> shape)
+{
+    static_assert(sizeof(T) == sizeof(ArrayType));
+
+    auto* owner = new std::vector<T>(std::move(vector));
+    py::capsule base(owner,
+                     [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    return py::array_t<ArrayType>(
+        shape, reinterpret_cast<const ArrayType*>(owner->data()), base);
+}
+
+//! Add bindings of PackedViconFrame for 1, ..., sizeof...(I) subjects.
+template <size_t... I>
+void add_packed_frame_bindings(py::module& m, std::index_sequence<I...>)
+{
+    (vicon_transformer::add_packed_frame_bindings<I + 1>(m), ...);
+}
+
+//! Frontend of o80Standalone (with default queue size) for N subjects.
+template <size_t N>
+using StandaloneFrontEnd =
+    o80::FrontEnd<vicon_transformer::STANDALONE_QUEUE_SIZE,
+                  vicon_transformer::STANDALONE_N_ACTUATORS,
+                  o80::VoidState,
+                  vicon_transformer::FixedSizeViconFrame<N>>;
+
+/**
+ * @brief Add packed history accessors for the frontends of o80Standalone with
+ * 1, ..., sizeof...(I) subjects.
+ */
+template <size_t... I>
+void add_packed_frontend_bindings(py::module& m, std::index_sequence<I...>)
+{
+    (vicon_transformer::add_packed_frontend_bindings<
+         StandaloneFrontEnd<I + 1>>(m),
+     ...);
+}
+
+/**
+ * @brief Convert SubjectPoses to a tuple (names, poses, is_visible).
+ *
+ * The arrays are moved to Python, so their data is not copied.
+ */
+py::tuple subject_poses_to_tuple(vicon_transformer::SubjectPoses&& poses)
+{
+    return py::make_tuple(
+        py::cast(std::move(poses.names)),
+        py::cast(std::move(poses.poses), py::return_value_policy::move),
+        py::cast(std::move(poses.is_visible), py::return_value_policy::move));
+}
+}  // namespace
+
 PYBIND11_MODULE(vicon_transformer_bindings, m)
 {
     namespace py = pybind11;
@@ -59,17 +154,79 @@ PYBIND11_MODULE(vicon_transformer_bindings, m)
                 stream << vf;
                 return stream.str();
             },
-            py::call_guard<py::gil_scoped_release>());
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "get_all_poses",
+            [](const vt::ViconFrame& frame)
+            { return subject_poses_to_tuple(vt::SubjectPoses(frame)); },
+            "Get the global poses of all subjects at once (same format as "
+            "ViconTransformer.get_all_transforms()).");
     m.def("to_json", &serialization_utils::to_json<vt::ViconFrame>);
     m.def("from_json", &serialization_utils::from_json<vt::ViconFrame>);
 
+    py::class_<vt::FlatViconFrame>(m, "FlatViconFrame")
+        .def(py::init<>())
+        .def(py::init<const vt::ViconFrame&>(), py::arg("frame"))
+        .def_readwrite("frame_number", &vt::FlatViconFrame::frame_number)
+        .def_readwrite("frame_rate", &vt::FlatViconFrame::frame_rate)
+        .def_readwrite("latency", &vt::FlatViconFrame::latency)
+        .def_readwrite("time_stamp", &vt::FlatViconFrame::time_stamp)
+        .def_property_readonly("subject_names",
+                               [](const vt::FlatViconFrame& frame)
+                               { return *frame.subject_names; })
+        .def_property(
+            "subjects",
+            [](const vt::FlatViconFrame& frame)
+            { return frame.subjects; },
+            [](vt::FlatViconFrame& frame,
+               const std::vector<vt::SubjectData>& subjects)
+            {
+                // the names are read-only, so the number of subjects must not
+                // change
+                if (subjects.size() != frame.subject_names->size())
+                {
+                    throw std::invalid_argument(fmt::format(
+                        "Expected {} subjects (one per subject name) but got "
+                        "{}.",
+                        frame.subject_names->size(),
+                        subjects.size()));
+                }
+                frame.subjects = subjects;
+            })
+        .def("find_subject", &vt::FlatViconFrame::find_subject)
+        .def("to_vicon_frame",
+             py::overload_cast<>(&vt::FlatViconFrame::to_vicon_frame,
+                                 py::const_))
+        .def(
+            "get_all_poses",
+            [](const vt::FlatViconFrame& frame)
+            { return subject_poses_to_tuple(vt::SubjectPoses(frame)); },
+            "Get the global poses of all subjects at once (same format as "
+            "ViconTransformer.get_all_transforms()).");
+
+    // packed frames for typical numbers of subjects (other sizes can be added
+    // by the code that defines the o80 driver, see pybind11_helper.hpp)
+    add_packed_frame_bindings(m, std::make_index_sequence<16>());
+    // histories of o80 frontends can be converted without creating a Python
+    // object per observation
+    add_packed_frontend_bindings(m, std::make_index_sequence<16>());
+
+    m.def("read_o80_subject_names",
+          &vt::read_o80_subject_names,
+          py::arg("segment_id"),
+          "Read the subject names published by the o80 standalone with the "
+          "given segment ID (index in the list corresponds to the index in "
+          "the frame).");
+
     py::class_<vt::ViconReceiverConfig>(m, "ViconReceiverConfig")
         .def(py::init<>())
         .def_readwrite("enable_lightweight",
                        &vt::ViconReceiverConfig::enable_lightweight)
         .def_readwrite("buffer_size", &vt::ViconReceiverConfig::buffer_size)
         .def_readwrite("filtered_subjects",
-                       &vt::ViconReceiverConfig::filtered_subjects);
+                       &vt::ViconReceiverConfig::filtered_subjects)
+        .def_readwrite("use_acquisition_thread",
+                       &vt::ViconReceiverConfig::use_acquisition_thread);
     m.def("to_json", &serialization_utils::to_json<vt::ViconReceiverConfig>);
     m.def("from_json",
           &serialization_utils::from_json<vt::ViconReceiverConfig>);
@@ -118,7 +275,199 @@ PYBIND11_MODULE(vicon_transformer_bindings, m)
              py::call_guard<py::gil_scoped_release>())
         .def("read",
              &vt::PlaybackReceiver::read,
-             py::call_guard<py::gil_scoped_release>());
+             py::call_guard<py::gil_scoped_release>())
+        .def("num_frames", &vt::PlaybackReceiver::num_frames)
+        .def("current_index", &vt::PlaybackReceiver::current_index)
+        .def("seek_to_frame",
+             &vt::PlaybackReceiver::seek_to_frame,
+             py::arg("frame_number"))
+        .def("seek_to_time",
+             &vt::PlaybackReceiver::seek_to_time,
+             py::arg("time_stamp_ns"))
+        .def("read_range",
+             &vt::PlaybackReceiver::read_range,
+             py::arg("start_time_stamp_ns"),
+             py::arg("end_time_stamp_ns"),
+             py::call_guard<py::gil_scoped_release>())
+        .def_readonly_static("MIN_PLAYBACK_SPEED",
+                             &vt::PlaybackReceiver::MIN_PLAYBACK_SPEED)
+        .def_readonly_static("MAX_PLAYBACK_SPEED",
+                             &vt::PlaybackReceiver::MAX_PLAYBACK_SPEED)
+        .def("set_playback_speed",
+             &vt::PlaybackReceiver::set_playback_speed,
+             py::arg("speed"))
+        .def("get_playback_speed", &vt::PlaybackReceiver::get_playback_speed)
+        .def("set_rewrite_time_stamps",
+             &vt::PlaybackReceiver::set_rewrite_time_stamps,
+             py::arg("enable"))
+        .def("is_rewrite_time_stamps_enabled",
+             &vt::PlaybackReceiver::is_rewrite_time_stamps_enabled);
+    py::class_<vt::SharedMemoryReceiver,
+               std::shared_ptr<vt::SharedMemoryReceiver>,
+               vt::Receiver>(m, "SharedMemoryReceiver")
+        .def(py::init<const std::string&, bool>(),
+             py::arg("name"),
+             py::arg("read_all_frames") = false)
+        .def("read",
+             &vt::SharedMemoryReceiver::read,
+             py::call_guard<py::gil_scoped_release>())
+        .def("is_publisher_closed",
+             &vt::SharedMemoryReceiver::is_publisher_closed)
+        .def("is_publisher_alive",
+             &vt::SharedMemoryReceiver::is_publisher_alive)
+        .def("num_dropped_frames",
+             &vt::SharedMemoryReceiver::num_dropped_frames);
+    py::class_<vt::SharedMemoryPublisher>(m, "SharedMemoryPublisher")
+        .def(py::init<const std::string&, uint32_t, uint32_t, bool>(),
+             py::arg("name"),
+             py::arg("num_slots") =
+                 vt::SharedMemoryPublisher::DEFAULT_NUM_SLOTS,
+             py::arg("max_frame_size") =
+                 vt::SharedMemoryPublisher::DEFAULT_MAX_FRAME_SIZE,
+             py::arg("take_over") = false)
+        .def("publish", &vt::SharedMemoryPublisher::publish, py::arg("frame"))
+        .def("num_published_frames",
+             &vt::SharedMemoryPublisher::num_published_frames);
+
+    m.def("convert_to_recording",
+          &vt::convert_to_recording,
+          py::arg("input_file"),
+          py::arg("output_file"),
+          py::arg("frames_per_chunk") = 300,
+          py::arg("quantization_step") = 0.0,
+          py::arg("rotation_quantization_step") = 0.0,
+          py::arg("num_threads") = 0,
+          py::call_guard<py::gil_scoped_release>(),
+          "Convert a recording to the current format (using multiple "
+          "threads).");
+
+    py::class_<vt::RecoveryResult>(m, "RecoveryResult")
+        .def_readonly("num_frames", &vt::RecoveryResult::num_frames)
+        .def_readonly("num_corrupted_chunks",
+                      &vt::RecoveryResult::num_corrupted_chunks)
+        .def_readonly("had_index", &vt::RecoveryResult::had_index);
+    m.def("recover_recording",
+          &vt::recover_recording,
+          py::arg("input_file"),
+          py::arg("output_file"),
+          py::call_guard<py::gil_scoped_release>(),
+          "Salvage all valid chunks of a damaged recording.");
+
+    m.def("export_columnar_recording",
+          &vt::export_columnar_recording,
+          py::arg("input_file"),
+          py::arg("output_file"),
+          py::call_guard<py::gil_scoped_release>(),
+          "Convert a recording to the column-oriented format.");
+
+    m.def(
+        "load_recording_columns",
+        [](const std::filesystem::path& filename,
+           int64_t start_time_stamp_ns,
+           int64_t end_time_stamp_ns)
+        {
+            vt::RecordingColumns columns;
+            {
+                py::gil_scoped_release release;
+                columns = vt::load_recording_columns(
+                    filename, start_time_stamp_ns, end_time_stamp_ns);
+            }
+
+            const py::ssize_t n = columns.num_frames();
+            py::dict subjects;
+            for (size_t i = 0; i < columns.subjects.size(); i++)
+            {
+                vt::RecordingColumns::Subject& subject = columns.subjects[i];
+                py::dict subject_dict;
+                subject_dict["translation"] =
+                    vector_to_array(std::move(subject.translation), {n, 3});
+                subject_dict["rotation"] =
+                    vector_to_array(std::move(subject.rotation), {n, 4});
+                subject_dict["quality"] =
+                    vector_to_array(std::move(subject.quality), {n});
+                subject_dict["is_visible"] = vector_to_array<uint8_t, bool>(
+                    std::move(subject.is_visible), {n});
+                subjects[py::str(columns.subject_names[i])] = subject_dict;
+            }
+
+            py::dict result;
+            result["time_stamps"] =
+                vector_to_array(std::move(columns.time_stamps), {n});
+            result["frame_numbers"] =
+                vector_to_array(std::move(columns.frame_numbers), {n});
+            result["subjects"] = subjects;
+            return result;
+        },
+        py::arg("filename"),
+        py::arg("start_time_stamp_ns") = std::numeric_limits<int64_t>::min(),
+        py::arg("end_time_stamp_ns") = std::numeric_limits<int64_t>::max(),
+        R"(Load a recording (or the time range [start, end) of it) into arrays.
+
+Returns a dictionary with the arrays "time_stamps" and "frame_numbers" and
+"subjects", which maps subject names to dictionaries in the format of
+``ColumnarRecording.get_subject()``.  Loading is done in C++ without holding
+the GIL.
+)");
+
+    // The columns are returned as numpy arrays that directly refer to the
+    // memory-mapped file.  Passing the Python object of the recording as base
+    // keeps it (and thus the mapping) alive as long as any of the arrays
+    // exist.
+    py::class_<vt::ColumnarRecording>(m, "ColumnarRecording")
+        .def(py::init<const std::filesystem::path&>(), py::arg("filename"))
+        .def_property_readonly("num_frames",
+                               &vt::ColumnarRecording::num_frames)
+        .def_property_readonly("subject_names",
+                               &vt::ColumnarRecording::subject_names)
+        .def_property_readonly(
+            "time_stamps",
+            [](py::object self)
+            {
+                const auto& rec = self.cast<const vt::ColumnarRecording&>();
+                return make_readonly_array<int64_t>(
+                    {py::ssize_t(rec.num_frames())}, rec.time_stamps(), self);
+            })
+        .def_property_readonly(
+            "frame_numbers",
+            [](py::object self)
+            {
+                const auto& rec = self.cast<const vt::ColumnarRecording&>();
+                return make_readonly_array<int32_t>(
+                    {py::ssize_t(rec.num_frames())}, rec.frame_numbers(), self);
+            })
+        .def(
+            "get_subject",
+            [](py::object self, const std::string& subject_name)
+            {
+                const auto& rec = self.cast<const vt::ColumnarRecording&>();
+                const vt::SubjectColumns columns = rec.subject(subject_name);
+                const py::ssize_t n = rec.num_frames();
+
+                py::dict result;
+                result["translation"] = make_readonly_array<double>(
+                    {n, 3}, columns.translation, self);
+                result["rotation"] = make_readonly_array<double>(
+                    {n, 4}, columns.rotation, self);
+                result["quality"] =
+                    make_readonly_array<double>({n}, columns.quality, self);
+                result["is_visible"] = make_readonly_array<bool>(
+                    {n},
+                    reinterpret_cast<const bool*>(columns.is_visible),
+                    self);
+                return result;
+            },
+            py::arg("subject_name"),
+            R"(Get the columns of a subject.
+
+Returns a dictionary with the numpy arrays "translation" (shape (N, 3)),
+"rotation" (quaternion (x, y, z, w), shape (N, 4)), "quality" and "is_visible"
+(shape (N,)).  The arrays refer directly to the memory-mapped file and are
+read-only.
+)");
+
+    py::class_<vt::SubjectHandle>(m, "SubjectHandle")
+        .def(py::init<>())
+        .def("index", &vt::SubjectHandle::index);
 
     py::class_<vt::ViconTransformer>(m, "ViconTransformer")
         .def(py::init<std::shared_ptr<vt::Receiver>, const std::string&>(),
@@ -138,13 +487,83 @@ PYBIND11_MODULE(vicon_transformer_bindings, m)
         .def("get_subject_names",
              &vt::ViconTransformer::get_subject_names,
              py::call_guard<py::gil_scoped_release>())
+        .def("resolve",
+             &vt::ViconTransformer::resolve,
+             py::arg("subject_name"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("is_valid",
+             &vt::ViconTransformer::is_valid,
+             py::arg("subject"),
+             py::call_guard<py::gil_scoped_release>())
         .def("is_visible",
-             &vt::ViconTransformer::is_visible,
+             py::overload_cast<const std::string&>(
+                 &vt::ViconTransformer::is_visible, py::const_),
+             py::call_guard<py::gil_scoped_release>())
+        .def("is_visible",
+             py::overload_cast<const vt::SubjectHandle&>(
+                 &vt::ViconTransformer::is_visible, py::const_),
+             py::call_guard<py::gil_scoped_release>())
+        .def("_get_transform_cpp",
+             py::overload_cast<const std::string&>(
+                 &vt::ViconTransformer::get_transform, py::const_),
              py::call_guard<py::gil_scoped_release>())
         .def("_get_transform_cpp",
-             &vt::ViconTransformer::get_transform,
+             py::overload_cast<const vt::SubjectHandle&>(
+                 &vt::ViconTransformer::get_transform, py::const_),
+             py::call_guard<py::gil_scoped_release>())
+        .def("_try_get_transform_cpp",
+             py::overload_cast<const std::string&>(
+                 &vt::ViconTransformer::try_get_transform, py::const_),
+             py::call_guard<py::gil_scoped_release>())
+        .def("_try_get_transform_cpp",
+             py::overload_cast<const vt::SubjectHandle&>(
+                 &vt::ViconTransformer::try_get_transform, py::const_),
+             py::call_guard<py::gil_scoped_release>())
+        .def(
+            "get_all_transforms",
+            [](const vt::ViconTransformer& self)
+            {
+                vt::SubjectPoses poses;
+                {
+                    py::gil_scoped_release release;
+                    self.get_all_transforms_into(poses);
+                }
+                return subject_poses_to_tuple(std::move(poses));
+            },
+            R"(Get poses of all subjects relative to the origin subject.
+
+Returns a tuple ``(names, poses, is_visible)`` where ``poses`` is a numpy array
+of shape (N, 7) with one row ``(tx, ty, tz, qx, qy, qz, qw)`` per subject and
+``is_visible`` a boolean array of shape (N,).  Rows of subjects that are not
+visible are NaN.
+)")
+        .def("set_latency_compensation",
+             &vt::ViconTransformer::set_latency_compensation,
+             py::arg("enable"),
+             py::arg("additional_offset_s") = 0.0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("is_latency_compensation_enabled",
+             &vt::ViconTransformer::is_latency_compensation_enabled,
+             py::call_guard<py::gil_scoped_release>())
+        .def("set_history_size",
+             &vt::ViconTransformer::set_history_size,
+             py::arg("num_frames"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("get_history_size",
+             &vt::ViconTransformer::get_history_size,
+             py::call_guard<py::gil_scoped_release>())
+        .def("_get_transform_at_cpp",
+             py::overload_cast<const std::string&, int64_t>(
+                 &vt::ViconTransformer::get_transform_at, py::const_),
+             py::call_guard<py::gil_scoped_release>())
+        .def("_get_transform_at_cpp",
+             py::overload_cast<const vt::SubjectHandle&, int64_t>(
+                 &vt::ViconTransformer::get_transform_at, py::const_),
              py::call_guard<py::gil_scoped_release>())
         .def("get_frame",
              &vt::ViconTransformer::get_frame,
+             py::call_guard<py::gil_scoped_release>())
+        .def("get_flat_frame",
+             &vt::ViconTransformer::get_flat_frame,
              py::call_guard<py::gil_scoped_release>());
 }
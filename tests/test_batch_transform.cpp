@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for batch_transform.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/batch_transform.hpp>
+
+#include "utils.hpp"
+
+using spatial_transformation::Transformation;
+using vicon_transformer::PoseArray;
+
+namespace
+{
+Transformation random_pose()
+{
+    return Transformation(Eigen::Quaterniond::UnitRandom(),
+                          Eigen::Vector3d::Random());
+}
+}  // namespace
+
+TEST(PoseArray, set_get)
+{
+    PoseArray poses;
+    poses.resize(3);
+
+    Transformation pose = random_pose();
+    poses.set(1, pose);
+
+    ASSERT_MATRIX_ALMOST_EQUAL(poses.get(1).matrix(), pose.matrix());
+}
+
+TEST(PoseArray, gather_scatter)
+{
+    std::vector<vicon_transformer::SubjectData> subjects(3);
+    for (auto &subject : subjects)
+    {
+        subject.global_pose = random_pose();
+        subject.is_visible = true;
+    }
+    subjects[1].is_visible = false;
+
+    PoseArray poses;
+    poses.gather(subjects);
+    ASSERT_EQ(poses.size(), 3u);
+    ASSERT_MATRIX_ALMOST_EQUAL(poses.get(2).matrix(),
+                               subjects[2].global_pose.matrix());
+
+    std::vector<vicon_transformer::SubjectData> result(3);
+    result[1].is_visible = false;
+    result[0].is_visible = result[2].is_visible = true;
+    poses.scatter_visible(result);
+
+    ASSERT_MATRIX_ALMOST_EQUAL(result[0].global_pose.matrix(),
+                               subjects[0].global_pose.matrix());
+    ASSERT_MATRIX_ALMOST_EQUAL(result[2].global_pose.matrix(),
+                               subjects[2].global_pose.matrix());
+    // not visible -> not written
+    ASSERT_MATRIX_ALMOST_EQUAL(result[1].global_pose.matrix(),
+                               Transformation::Identity().matrix());
+}
+
+TEST(transform_poses, matches_transformation_product)
+{
+    // use an odd number, so SIMD loops have a remainder
+    constexpr size_t N = 37;
+
+    Transformation tf = random_pose();
+
+    PoseArray poses;
+    poses.resize(N);
+    for (size_t i = 0; i < N; i++)
+    {
+        poses.set(i, random_pose());
+    }
+
+    PoseArray result;
+    vicon_transformer::transform_poses(tf, poses, result);
+
+    ASSERT_EQ(result.size(), N);
+    for (size_t i = 0; i < N; i++)
+    {
+        Transformation expected = tf * poses.get(i);
+        ASSERT_MATRIX_ALMOST_EQUAL(result.get(i).matrix(), expected.matrix());
+    }
+}
+
+TEST(extrapolate_poses, constant_velocity)
+{
+    const Eigen::Vector3d axis = Eigen::Vector3d(1, 2, 3).normalized();
+
+    PoseArray previous, current;
+    previous.resize(2);
+    current.resize(2);
+
+    // moving subject
+    using Eigen::AngleAxisd;
+    previous.set(0,
+                 Transformation(Eigen::Quaterniond(AngleAxisd(0.1, axis)),
+                                Eigen::Vector3d(1, 2, 3)));
+    current.set(0,
+                Transformation(Eigen::Quaterniond(AngleAxisd(0.12, axis)),
+                               Eigen::Vector3d(1.1, 2, 2.8)));
+    // static subject
+    Transformation static_pose = random_pose();
+    previous.set(1, static_pose);
+    current.set(1, static_pose);
+
+    PoseArray result;
+    vicon_transformer::extrapolate_poses(previous, current, 1.5, result);
+
+    ASSERT_EQ(result.size(), 2u);
+    Transformation expected(Eigen::Quaterniond(Eigen::AngleAxisd(0.15, axis)),
+                            Eigen::Vector3d(1.25, 2, 2.5));
+    // the rotation is only approximated, so allow a slightly larger error
+    ASSERT_TRUE(result.get(0).translation.isApprox(expected.translation));
+    ASSERT_LT(result.get(0).rotation.angularDistance(expected.rotation), 1e-4);
+    ASSERT_MATRIX_ALMOST_EQUAL(result.get(1).matrix(), static_pose.matrix());
+}
+
+TEST(extrapolate_poses, quaternion_sign)
+{
+    // q and -q are the same rotation, so this must not be extrapolated
+    Eigen::Quaterniond q = Eigen::Quaterniond::UnitRandom();
+    Eigen::Quaterniond neg_q(-q.w(), -q.x(), -q.y(), -q.z());
+
+    PoseArray previous, current;
+    previous.resize(1);
+    current.resize(1);
+    previous.set(0, Transformation(neg_q, Eigen::Vector3d::Zero()));
+    current.set(0, Transformation(q, Eigen::Vector3d::Zero()));
+
+    PoseArray result;
+    vicon_transformer::extrapolate_poses(previous, current, 2.0, result);
+
+    ASSERT_LT(result.get(0).rotation.angularDistance(q), 1e-9);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
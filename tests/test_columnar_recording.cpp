@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for columnar_recording.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/columnar_recording.hpp>
+#include <vicon_transformer/errors.hpp>
+#include <vicon_transformer/vicon_receiver.hpp>
+
+using vicon_transformer::ColumnarRecording;
+using vicon_transformer::PlaybackReceiver;
+using vicon_transformer::SubjectColumns;
+using vicon_transformer::ViconFrame;
+
+namespace
+{
+// assumes test is executed in package root directory
+const std::string RECORDING_FILE = "tests/data/recording_3s.dat";
+
+std::filesystem::path get_temp_file(const std::string &name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+}  // namespace
+
+TEST(ColumnarRecording, export_and_read)
+{
+    const auto filename = get_temp_file("test_columnar_export.vcol");
+    vicon_transformer::export_columnar_recording(RECORDING_FILE, filename);
+
+    ColumnarRecording columns(filename);
+    PlaybackReceiver receiver(RECORDING_FILE);
+    ASSERT_EQ(columns.num_frames(), receiver.num_frames());
+
+    ViconFrame frame = receiver.read();
+    ASSERT_FALSE(frame.subjects.empty());
+    ASSERT_EQ(columns.subject_names().size(), frame.subjects.size());
+
+    std::vector<SubjectColumns> subjects;
+    for (const std::string &name : columns.subject_names())
+    {
+        subjects.push_back(columns.subject(name));
+    }
+
+    for (size_t i = 0; i < columns.num_frames(); i++)
+    {
+        if (i > 0)
+        {
+            receiver.read_into(frame);
+        }
+        ASSERT_EQ(columns.time_stamps()[i], frame.time_stamp);
+        ASSERT_EQ(columns.frame_numbers()[i], frame.frame_number);
+
+        for (size_t s = 0; s < subjects.size(); s++)
+        {
+            const auto &data = frame.subjects.at(columns.subject_names()[s]);
+            ASSERT_EQ(subjects[s].is_visible[i], data.is_visible);
+            if (data.is_visible)
+            {
+                const auto &pose = data.global_pose;
+                EXPECT_EQ(subjects[s].translation[3 * i], pose.translation.x());
+                EXPECT_EQ(subjects[s].translation[3 * i + 2],
+                          pose.translation.z());
+                EXPECT_EQ(subjects[s].rotation[4 * i], pose.rotation.x());
+                EXPECT_EQ(subjects[s].rotation[4 * i + 3], pose.rotation.w());
+                EXPECT_EQ(subjects[s].quality[i], data.quality);
+            }
+            else
+            {
+                EXPECT_EQ(subjects[s].translation[3 * i], 0.0);
+            }
+        }
+    }
+
+    std::filesystem::remove(filename);
+}
+
+TEST(ColumnarRecording, unknown_subject)
+{
+    const auto filename = get_temp_file("test_columnar_unknown.vcol");
+    vicon_transformer::export_columnar_recording(RECORDING_FILE, filename);
+
+    ColumnarRecording columns(filename);
+    EXPECT_THROW(columns.subject("does_not_exist"),
+                 vicon_transformer::UnknownSubjectError);
+    EXPECT_THROW(columns.subject(columns.subject_names().size()),
+                 std::out_of_range);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(ColumnarRecording, invalid_file)
+{
+    EXPECT_THROW(ColumnarRecording{RECORDING_FILE}, std::runtime_error);
+
+    // truncated file
+    const auto filename = get_temp_file("test_columnar_truncated.vcol");
+    vicon_transformer::export_columnar_recording(RECORDING_FILE, filename);
+    std::filesystem::resize_file(filename,
+                                 std::filesystem::file_size(filename) - 8);
+    EXPECT_THROW(ColumnarRecording{filename}, std::runtime_error);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(ColumnarRecording, corrupted_num_frames)
+{
+    const auto filename = get_temp_file("test_columnar_num_frames.vcol");
+    vicon_transformer::export_columnar_recording(RECORDING_FILE, filename);
+
+    // Number of frames for which the column sizes overflow 64 bits.  Without
+    // a check this could wrap around to an offset that fits into the file.
+    const uint64_t num_frames = std::numeric_limits<uint64_t>::max() / 8 + 1;
+    {
+        std::fstream file(filename,
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(16);
+        file.write(reinterpret_cast<const char *>(&num_frames),
+                   sizeof(num_frames));
+    }
+    EXPECT_THROW(ColumnarRecording{filename}, std::runtime_error);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(RecordingColumns, load)
+{
+    const auto filename = get_temp_file("test_columnar_load.vcol");
+    vicon_transformer::export_columnar_recording(RECORDING_FILE, filename);
+    ColumnarRecording expected(filename);
+
+    vicon_transformer::RecordingColumns columns =
+        vicon_transformer::load_recording_columns(RECORDING_FILE);
+    ASSERT_EQ(columns.num_frames(), expected.num_frames());
+    ASSERT_EQ(columns.frame_numbers.size(), expected.num_frames());
+    ASSERT_EQ(columns.subject_names, expected.subject_names());
+    ASSERT_EQ(columns.subjects.size(), columns.subject_names.size());
+
+    const size_t n = columns.num_frames();
+    for (size_t i = 0; i < n; i++)
+    {
+        ASSERT_EQ(columns.time_stamps[i], expected.time_stamps()[i]);
+        ASSERT_EQ(columns.frame_numbers[i], expected.frame_numbers()[i]);
+    }
+    for (size_t s = 0; s < columns.subjects.size(); s++)
+    {
+        const auto &subject = columns.subjects[s];
+        const SubjectColumns expected_subject = expected.subject(s);
+        ASSERT_EQ(subject.translation.size(), 3 * n);
+        ASSERT_EQ(subject.rotation.size(), 4 * n);
+        ASSERT_EQ(subject.quality.size(), n);
+        ASSERT_EQ(subject.is_visible.size(), n);
+        EXPECT_TRUE(std::equal(subject.translation.begin(),
+                               subject.translation.end(),
+                               expected_subject.translation));
+        EXPECT_TRUE(std::equal(subject.rotation.begin(),
+                               subject.rotation.end(),
+                               expected_subject.rotation));
+        EXPECT_TRUE(std::equal(subject.quality.begin(),
+                               subject.quality.end(),
+                               expected_subject.quality));
+        EXPECT_TRUE(std::equal(subject.is_visible.begin(),
+                               subject.is_visible.end(),
+                               expected_subject.is_visible));
+    }
+
+    std::filesystem::remove(filename);
+}
+
+TEST(RecordingColumns, load_range)
+{
+    const auto all = vicon_transformer::load_recording_columns(RECORDING_FILE);
+    ASSERT_GT(all.num_frames(), 20u);
+
+    const int64_t start = all.time_stamps[10];
+    const int64_t end = all.time_stamps[20];
+    const auto range =
+        vicon_transformer::load_recording_columns(RECORDING_FILE, start, end);
+    ASSERT_EQ(range.num_frames(), 10u);
+    EXPECT_EQ(range.frame_numbers.front(), all.frame_numbers[10]);
+    EXPECT_EQ(range.frame_numbers.back(), all.frame_numbers[19]);
+    ASSERT_EQ(range.subject_names, all.subject_names);
+    EXPECT_EQ(range.subjects[0].translation[0],
+              all.subjects[0].translation[3 * 10]);
+
+    // empty ranges
+    EXPECT_EQ(vicon_transformer::load_recording_columns(
+                  RECORDING_FILE, end, start)
+                  .num_frames(),
+              0u);
+    EXPECT_EQ(vicon_transformer::load_recording_columns(
+                  RECORDING_FILE, all.time_stamps.back() + 1)
+                  .num_frames(),
+              0u);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for frame_codec.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/frame_codec.hpp>
+#include <vicon_transformer/vicon_receiver.hpp>
+
+using vicon_transformer::FrameDecoder;
+using vicon_transformer::FrameEncoder;
+using vicon_transformer::ViconFrame;
+
+namespace
+{
+// assumes test is executed in package root directory
+const std::string RECORDING_FILE = "tests/data/recording_3s.dat";
+
+std::vector<ViconFrame> load_test_frames(size_t max_frames)
+{
+    vicon_transformer::PlaybackReceiver receiver(RECORDING_FILE);
+    std::vector<ViconFrame> frames;
+    while (frames.size() < std::min(max_frames, receiver.num_frames()))
+    {
+        frames.push_back(receiver.read());
+    }
+    return frames;
+}
+
+//! Encode all frames, then decode them again.
+std::vector<ViconFrame> encode_decode(const std::vector<ViconFrame> &frames,
+                                      double quantization_step,
+                                      double rotation_quantization_step = 0.0,
+                                      size_t *encoded_size = nullptr)
+{
+    FrameEncoder encoder(quantization_step, rotation_quantization_step);
+    std::vector<std::vector<char>> encoded(frames.size());
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        encoder.encode(frames[i], encoded[i]);
+    }
+
+    FrameDecoder decoder(quantization_step, rotation_quantization_step);
+    std::vector<ViconFrame> decoded(frames.size());
+    size_t total_size = 0;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        decoder.decode(encoded[i].data(), encoded[i].size(), decoded[i]);
+        total_size += encoded[i].size();
+    }
+    if (encoded_size)
+    {
+        *encoded_size = total_size;
+    }
+    return decoded;
+}
+}  // namespace
+
+TEST(varint, round_trip)
+{
+    const std::vector<uint64_t> values = {
+        0, 1, 127, 128, 300, 1ull << 35, std::numeric_limits<uint64_t>::max()};
+
+    std::vector<char> buffer;
+    for (uint64_t value : values)
+    {
+        vicon_transformer::append_varint(buffer, value);
+    }
+    // small values need a single byte
+    EXPECT_EQ(buffer[0], 0);
+    EXPECT_EQ(buffer[2], 127);
+
+    const char *pos = buffer.data();
+    const char *end = buffer.data() + buffer.size();
+    for (uint64_t value : values)
+    {
+        EXPECT_EQ(vicon_transformer::read_varint(pos, end), value);
+    }
+    EXPECT_EQ(pos, end);
+    EXPECT_THROW(vicon_transformer::read_varint(pos, end), std::runtime_error);
+}
+
+TEST(zigzag, round_trip)
+{
+    for (int64_t value : {int64_t(0),
+                          int64_t(-1),
+                          int64_t(1),
+                          int64_t(-1000),
+                          std::numeric_limits<int64_t>::min(),
+                          std::numeric_limits<int64_t>::max()})
+    {
+        EXPECT_EQ(vicon_transformer::zigzag_decode(
+                      vicon_transformer::zigzag_encode(value)),
+                  value);
+    }
+    EXPECT_EQ(vicon_transformer::zigzag_encode(-1), 1u);
+    EXPECT_EQ(vicon_transformer::zigzag_encode(1), 2u);
+}
+
+TEST(FrameCodec, lossless)
+{
+    std::vector<ViconFrame> frames = load_test_frames(100);
+    std::vector<ViconFrame> decoded = encode_decode(frames, 0.0);
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        EXPECT_EQ(decoded[i].frame_rate, frames[i].frame_rate);
+        EXPECT_EQ(decoded[i].latency, frames[i].latency);
+        ASSERT_EQ(decoded[i].subjects.size(), frames[i].subjects.size());
+        for (const auto &[name, subject] : frames[i].subjects)
+        {
+            const auto &result = decoded[i].subjects.at(name);
+            EXPECT_EQ(result.is_visible, subject.is_visible);
+            // values of invisible subjects are not stored
+            if (!subject.is_visible)
+            {
+                continue;
+            }
+            EXPECT_EQ(result.quality, subject.quality);
+            EXPECT_TRUE(result.global_pose.translation ==
+                        subject.global_pose.translation);
+            EXPECT_TRUE(result.global_pose.rotation.coeffs() ==
+                        subject.global_pose.rotation.coeffs());
+        }
+    }
+}
+
+TEST(FrameCodec, quantized)
+{
+    constexpr double step = 1e-6;
+    constexpr double rotation_step = 1e-7;
+    std::vector<ViconFrame> frames = load_test_frames(100);
+
+    size_t encoded_size;
+    std::vector<ViconFrame> decoded =
+        encode_decode(frames, step, rotation_step, &encoded_size);
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        for (const auto &[name, subject] : frames[i].subjects)
+        {
+            const auto &result = decoded[i].subjects.at(name);
+            EXPECT_EQ(result.is_visible, subject.is_visible);
+            if (!subject.is_visible)
+            {
+                continue;
+            }
+            EXPECT_NEAR(result.quality, subject.quality, step);
+            EXPECT_LE((result.global_pose.translation -
+                       subject.global_pose.translation)
+                          .cwiseAbs()
+                          .maxCoeff(),
+                      step);
+            // normalisation may change the components by a bit more than
+            // the step
+            EXPECT_LE((result.global_pose.rotation.coeffs() -
+                       subject.global_pose.rotation.coeffs())
+                          .cwiseAbs()
+                          .maxCoeff(),
+                      2 * rotation_step);
+            EXPECT_NEAR(result.global_pose.rotation.norm(), 1.0, 1e-12);
+        }
+    }
+
+    // compare with the size of the frames serialised with cereal (which is
+    // about 930 bytes per frame for the test recording)
+    EXPECT_LT(encoded_size, frames.size() * 930 / 5);
+}
+
+TEST(FrameCodec, quantized_translation_only)
+{
+    constexpr double step = 1e-3;
+    std::vector<ViconFrame> frames = load_test_frames(10);
+    std::vector<ViconFrame> decoded = encode_decode(frames, step, 0.0);
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        for (const auto &[name, subject] : frames[i].subjects)
+        {
+            if (!subject.is_visible)
+            {
+                continue;
+            }
+            const auto &result = decoded[i].subjects.at(name);
+            EXPECT_LE((result.global_pose.translation -
+                       subject.global_pose.translation)
+                          .cwiseAbs()
+                          .maxCoeff(),
+                      step);
+            // rotation is not affected by the translation step
+            EXPECT_TRUE(result.global_pose.rotation.coeffs() ==
+                        subject.global_pose.rotation.coeffs());
+        }
+    }
+}
+
+TEST(FrameCodec, invisible_subject_with_nan)
+{
+    constexpr double step = 1e-6;
+    constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<ViconFrame> frames = load_test_frames(3);
+    auto &subject = frames[1].subjects.begin()->second;
+    subject.is_visible = false;
+    subject.global_pose.translation.x() = nan;
+    subject.quality = nan;
+
+    std::vector<ViconFrame> decoded;
+    ASSERT_NO_THROW(decoded = encode_decode(frames, step, step));
+
+    const std::string &name = frames[1].subjects.begin()->first;
+    const auto &result = decoded[1].subjects.at(name);
+    EXPECT_FALSE(result.is_visible);
+    EXPECT_TRUE(result.global_pose.translation.isZero());
+    EXPECT_EQ(result.quality, 0.0);
+
+    // the next frame is still decoded correctly
+    const auto &next = decoded[2].subjects.at(name);
+    const auto &expected = frames[2].subjects.at(name);
+    ASSERT_EQ(next.is_visible, expected.is_visible);
+    if (expected.is_visible)
+    {
+        EXPECT_LE((next.global_pose.translation -
+                   expected.global_pose.translation)
+                      .cwiseAbs()
+                      .maxCoeff(),
+                  step);
+    }
+}
+
+TEST(FrameCodec, subjects_change)
+{
+    std::vector<ViconFrame> frames = load_test_frames(3);
+    frames[1].subjects["new_subject"].is_visible = true;
+    frames[2].subjects.erase(frames[2].subjects.begin());
+
+    std::vector<ViconFrame> decoded = encode_decode(frames, 0.0);
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        ASSERT_EQ(decoded[i].subjects.size(), frames[i].subjects.size());
+        auto it = decoded[i].subjects.begin();
+        for (const auto &[name, subject] : frames[i].subjects)
+        {
+            EXPECT_EQ(it->first, name);
+            EXPECT_EQ(it->second.is_visible, subject.is_visible);
+            ++it;
+        }
+    }
+}
+
+TEST(FrameCodec, reset)
+{
+    std::vector<ViconFrame> frames = load_test_frames(2);
+
+    FrameEncoder encoder;
+    std::vector<char> first, second;
+    encoder.encode(frames[0], first);
+    encoder.encode(frames[1], second);
+
+    // second frame depends on the first one
+    FrameDecoder decoder;
+    ViconFrame frame;
+    EXPECT_THROW(decoder.decode(second.data(), second.size(), frame),
+                 std::runtime_error);
+
+    // after reset, it can be decoded on its own
+    encoder.reset();
+    second.clear();
+    encoder.encode(frames[1], second);
+    decoder.decode(second.data(), second.size(), frame);
+    EXPECT_EQ(frame.latency, frames[1].latency);
+}
+
+TEST(FrameCodec, invalid_data)
+{
+    std::vector<ViconFrame> frames = load_test_frames(1);
+
+    FrameEncoder encoder;
+    std::vector<char> encoded;
+    encoder.encode(frames[0], encoded);
+
+    FrameDecoder decoder;
+    ViconFrame frame;
+    EXPECT_THROW(decoder.decode(encoded.data(), encoded.size() - 1, frame),
+                 std::runtime_error);
+
+    EXPECT_THROW(FrameEncoder(-1.0), std::invalid_argument);
+    EXPECT_THROW(FrameEncoder(0.0, -1.0), std::invalid_argument);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,344 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for o80_driver.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/o80_driver.hpp>
+#include <vicon_transformer/vicon_receiver.hpp>
+
+using vicon_transformer::ViconFrame;
+
+namespace
+{
+struct TestSubjects
+{
+    static constexpr std::array<std::string_view, 3> names = {
+        "rll_ping_base", "rll_muscle_base", "rll_led_stick"};
+};
+using Driver = vicon_transformer::o80SubjectListDriver<TestSubjects>;
+
+/**
+ * @brief Receiver that only returns frames when allowed by the test.
+ *
+ * Returns the frame of a JSON file with increasing frame numbers.  read()
+ * blocks until the test calls release() or release_all().  In frames selected
+ * with hide_in_frame(), the subject HIDDEN_SUBJECT is not visible.
+ */
+class ControlledReceiver : public vicon_transformer::Receiver
+{
+public:
+    static constexpr const char *HIDDEN_SUBJECT = "rll_ping_base";
+
+    ControlledReceiver() : receiver_("tests/data/test_frame1.json")
+    {
+    }
+
+    ViconFrame read() override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        num_waiting_++;
+        cond_.notify_all();
+        cond_.wait(lock,
+                   [this]
+                   { return num_released_ > 0 || release_all_ || fail_; });
+        num_waiting_--;
+        if (fail_)
+        {
+            throw std::runtime_error("receiver failed");
+        }
+        if (!release_all_)
+        {
+            num_released_--;
+        }
+
+        ViconFrame frame = receiver_.read();
+        frame.frame_number = frame_number_++;
+        if (hidden_frames_.count(frame.frame_number))
+        {
+            frame.subjects.at(HIDDEN_SUBJECT).is_visible = false;
+        }
+        return frame;
+    }
+
+    //! Mark the subject HIDDEN_SUBJECT as not visible in the given frame.
+    void hide_in_frame(int frame_number)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hidden_frames_.insert(frame_number);
+    }
+
+    //! Allow n more frames to be read.
+    void release(int n)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_released_ += n;
+        cond_.notify_all();
+    }
+
+    //! Stop blocking, i.e. allow all future calls of read().
+    void release_all()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        release_all_ = true;
+        cond_.notify_all();
+    }
+
+    //! Let all pending and future calls of read() throw.
+    void fail()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fail_ = true;
+        cond_.notify_all();
+    }
+
+    //! Let calls of read() succeed again after fail().
+    void recover()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fail_ = false;
+    }
+
+    //! Block until all released frames are read and read() is waiting again.
+    void wait_until_idle()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock,
+                   [this]
+                   { return num_released_ == 0 && num_waiting_ > 0; });
+    }
+
+private:
+    vicon_transformer::JsonReceiver receiver_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    int num_released_ = 0;
+    int num_waiting_ = 0;
+    bool release_all_ = false;
+    bool fail_ = false;
+    int frame_number_ = 0;
+    std::set<int> hidden_frames_;
+};
+}  // namespace
+
+TEST(o80Driver, synchronous)
+{
+    auto receiver = std::make_shared<ControlledReceiver>();
+    Driver driver(receiver, "rll_ping_base");
+
+    receiver->release(2);
+    driver.start();
+    auto frame = driver.get();
+    EXPECT_EQ(frame.frame_number, 1);
+    EXPECT_TRUE(frame.subjects[Driver::Subjects::index_of("rll_ping_base")]
+                    .is_visible);
+    EXPECT_TRUE(driver.get_staleness().is_new);
+    EXPECT_EQ(driver.get_staleness().frames_missed, 0u);
+}
+
+TEST(o80Driver, acquisition_thread)
+{
+    auto receiver = std::make_shared<ControlledReceiver>();
+    Driver driver(receiver, "rll_ping_base", nullptr, true);
+
+    receiver->release(1);
+    driver.start();
+
+    auto frame = driver.get();
+    EXPECT_EQ(frame.frame_number, 0);
+    EXPECT_TRUE(driver.get_staleness().is_new);
+    EXPECT_EQ(driver.get_staleness().frames_missed, 0u);
+
+    // no new frame available, so the same frame is returned without blocking
+    receiver->wait_until_idle();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    frame = driver.get();
+    EXPECT_EQ(frame.frame_number, 0);
+    EXPECT_FALSE(driver.get_staleness().is_new);
+    EXPECT_GE(driver.get_staleness().age_ns, 10'000'000);
+    // staleness is also provided in the frame
+    EXPECT_EQ(frame.age_ns, driver.get_staleness().age_ns);
+
+    // only the latest of multiple new frames is returned
+    receiver->release(3);
+    receiver->wait_until_idle();
+    frame = driver.get();
+    EXPECT_EQ(frame.frame_number, 3);
+    EXPECT_TRUE(driver.get_staleness().is_new);
+    EXPECT_EQ(driver.get_staleness().frames_missed, 2u);
+    EXPECT_EQ(frame.frames_missed, 2u);
+
+    // unblock the pending read(), so the acquisition thread can stop
+    receiver->release_all();
+    driver.stop();
+}
+
+TEST(o80Driver, acquisition_thread_start_twice)
+{
+    auto receiver = std::make_shared<ControlledReceiver>();
+    Driver driver(receiver, "rll_ping_base", nullptr, true);
+
+    receiver->release(1);
+    driver.start();
+    receiver->wait_until_idle();
+
+    // The thread is still running, so this must neither read from the receiver
+    // nor touch the transformer (no frame is released, so a read would block).
+    driver.start();
+
+    // the next frame is still received by the acquisition thread
+    receiver->release(1);
+    receiver->wait_until_idle();
+    EXPECT_EQ(driver.get().frame_number, 1);
+
+    receiver->release_all();
+    driver.stop();
+}
+
+TEST(o80Driver, acquisition_thread_error)
+{
+    auto receiver = std::make_shared<ControlledReceiver>();
+    Driver driver(receiver, "rll_ping_base", nullptr, true);
+
+    receiver->release(1);
+    driver.start();
+    receiver->fail();
+
+    // the error is forwarded once the acquisition thread terminated
+    auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < timeout)
+    {
+        try
+        {
+            driver.get();
+        }
+        catch (const std::runtime_error &e)
+        {
+            EXPECT_STREQ(e.what(), "receiver failed");
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    FAIL() << "Error of the acquisition thread was not forwarded.";
+}
+
+TEST(o80Driver, acquisition_thread_origin_occluded)
+{
+    auto receiver = std::make_shared<ControlledReceiver>();
+    Driver driver(receiver, ControlledReceiver::HIDDEN_SUBJECT, nullptr, true);
+    receiver->hide_in_frame(1);
+
+    receiver->release(1);
+    driver.start();
+    EXPECT_EQ(driver.get().frame_number, 0);
+
+    // frame without origin subject is skipped
+    receiver->release(1);
+    receiver->wait_until_idle();
+    auto frame = driver.get();
+    EXPECT_EQ(frame.frame_number, 0);
+    EXPECT_FALSE(driver.get_staleness().is_new);
+
+    // acquisition continues once the origin subject is visible again
+    receiver->release(1);
+    receiver->wait_until_idle();
+    frame = driver.get();
+    EXPECT_EQ(frame.frame_number, 2);
+    EXPECT_TRUE(driver.get_staleness().is_new);
+    EXPECT_TRUE(
+        frame.subjects[Driver::Subjects::index_of("rll_ping_base")].is_visible);
+
+    receiver->release_all();
+    driver.stop();
+}
+
+TEST(o80Driver, acquisition_thread_restart_after_error)
+{
+    auto receiver = std::make_shared<ControlledReceiver>();
+    Driver driver(receiver, "rll_ping_base", nullptr, true);
+
+    receiver->release(1);
+    driver.start();
+    receiver->fail();
+
+    bool failed = false;
+    auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!failed && std::chrono::steady_clock::now() < timeout)
+    {
+        try
+        {
+            driver.get();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        catch (const std::runtime_error &)
+        {
+            failed = true;
+        }
+    }
+    ASSERT_TRUE(failed);
+
+    // after restarting, the previous error is not reported anymore
+    receiver->recover();
+    receiver->release(1);
+    driver.start();
+    EXPECT_NO_THROW(driver.get());
+
+    receiver->release_all();
+    driver.stop();
+}
+
+TEST(o80RuntimeSubjectsDriver, subject_mapping)
+{
+    using RuntimeDriver = vicon_transformer::o80RuntimeSubjectsDriver<5>;
+    const std::vector<std::string> names = {"rll_muscle_base", "rll_ping_base"};
+
+    auto receiver = std::make_shared<ControlledReceiver>();
+    RuntimeDriver driver(receiver, "rll_ping_base", names);
+    EXPECT_EQ(driver.get_subject_names(), names);
+
+    receiver->release(2);
+    driver.start();
+    auto frame = driver.get();
+    EXPECT_TRUE(frame.subjects[0].is_visible);
+    EXPECT_TRUE(frame.subjects[1].is_visible);
+    // origin subject is at identity
+    EXPECT_TRUE(frame.subjects[1].global_pose.translation.isZero(1e-9));
+    EXPECT_FALSE(frame.subjects[0].global_pose.translation.isZero(1e-9));
+    // unused slots
+    EXPECT_FALSE(frame.subjects[2].is_visible);
+    EXPECT_FALSE(frame.subjects[4].is_visible);
+}
+
+TEST(o80RuntimeSubjectsDriver, invalid_names)
+{
+    using RuntimeDriver = vicon_transformer::o80RuntimeSubjectsDriver<2>;
+    auto receiver = std::make_shared<ControlledReceiver>();
+
+    EXPECT_THROW(RuntimeDriver(receiver, "a", {"a", "b", "c"}),
+                 std::invalid_argument);
+    EXPECT_THROW(RuntimeDriver(receiver, "a", {"a", "a"}),
+                 std::invalid_argument);
+    EXPECT_THROW(RuntimeDriver(receiver, "a", {"a", ""}),
+                 std::invalid_argument);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for pose_history.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/pose_history.hpp>
+
+#include "utils.hpp"
+
+using spatial_transformation::Transformation;
+using vicon_transformer::FlatViconFrame;
+using vicon_transformer::PoseHistory;
+using vicon_transformer::ViconFrame;
+
+namespace
+{
+//! Create a frame with the subject "foo" at the given pose.
+FlatViconFrame make_frame(int64_t time_stamp,
+                          const Transformation &pose,
+                          bool is_visible = true)
+{
+    ViconFrame frame;
+    frame.time_stamp = time_stamp;
+    frame.subjects["foo"].global_pose = pose;
+    frame.subjects["foo"].is_visible = is_visible;
+    return FlatViconFrame(frame);
+}
+
+Transformation translation(double x)
+{
+    return Transformation(Eigen::Quaterniond::Identity(),
+                          Eigen::Vector3d(x, 0, 0));
+}
+}  // namespace
+
+TEST(PoseHistory, empty)
+{
+    PoseHistory history(0);
+    history.add(make_frame(1, translation(1)));
+
+    EXPECT_EQ(history.size(), 0u);
+    EXPECT_FALSE(history.get_pose_at("foo", 1));
+}
+
+TEST(PoseHistory, capacity)
+{
+    PoseHistory history(3);
+    for (int64_t t = 1; t <= 5; t++)
+    {
+        history.add(make_frame(t * 10, translation(t)));
+    }
+
+    EXPECT_EQ(history.size(), 3u);
+    EXPECT_EQ(history.oldest_time_stamp(), 30);
+    EXPECT_EQ(history.newest_time_stamp(), 50);
+
+    // older frames are dropped
+    EXPECT_FALSE(history.get_pose_at("foo", 20));
+    EXPECT_TRUE(history.get_pose_at("foo", 30));
+}
+
+TEST(PoseHistory, exact_time)
+{
+    PoseHistory history(5);
+    history.add(make_frame(10, translation(1)));
+    history.add(make_frame(20, translation(2)));
+
+    auto pose = history.get_pose_at("foo", 20);
+    ASSERT_TRUE(pose);
+    ASSERT_MATRIX_ALMOST_EQUAL(pose->matrix(), translation(2).matrix());
+}
+
+TEST(PoseHistory, interpolation)
+{
+    const Eigen::Quaterniond rot_a = Eigen::Quaterniond::Identity();
+    const Eigen::Quaterniond rot_b(
+        Eigen::AngleAxisd(M_PI / 2, Eigen::Vector3d::UnitZ()));
+
+    PoseHistory history(5);
+    history.add(make_frame(0, Transformation(rot_a, Eigen::Vector3d::Zero())));
+    history.add(
+        make_frame(100, Transformation(rot_b, Eigen::Vector3d(2, 4, 0))));
+
+    auto pose = history.get_pose_at("foo", 25);
+    ASSERT_TRUE(pose);
+
+    const Transformation expected(
+        Eigen::Quaterniond(
+            Eigen::AngleAxisd(M_PI / 8, Eigen::Vector3d::UnitZ())),
+        Eigen::Vector3d(0.5, 1, 0));
+    ASSERT_MATRIX_ALMOST_EQUAL(pose->matrix(), expected.matrix());
+}
+
+TEST(PoseHistory, out_of_range)
+{
+    PoseHistory history(5);
+    history.add(make_frame(10, translation(1)));
+    history.add(make_frame(20, translation(2)));
+
+    EXPECT_FALSE(history.get_pose_at("foo", 9));
+    EXPECT_FALSE(history.get_pose_at("foo", 21));
+    EXPECT_FALSE(history.get_pose_at("bar", 15));
+}
+
+TEST(PoseHistory, not_visible)
+{
+    PoseHistory history(5);
+    history.add(make_frame(10, translation(1)));
+    history.add(make_frame(20, translation(2), false));
+    history.add(make_frame(30, translation(3)));
+
+    EXPECT_TRUE(history.get_pose_at("foo", 10));
+    EXPECT_FALSE(history.get_pose_at("foo", 15));
+    EXPECT_FALSE(history.get_pose_at("foo", 25));
+}
+
+TEST(PoseHistory, time_going_backwards_clears)
+{
+    PoseHistory history(5);
+    history.add(make_frame(10, translation(1)));
+    history.add(make_frame(20, translation(2)));
+    history.add(make_frame(5, translation(3)));
+
+    EXPECT_EQ(history.size(), 1u);
+    EXPECT_EQ(history.oldest_time_stamp(), 5);
+}
+
+TEST(PoseHistory, by_index)
+{
+    PoseHistory history(5);
+    history.add(make_frame(10, translation(1)));
+
+    // frame with a different set of subjects, so "foo" has a different index
+    ViconFrame frame;
+    frame.time_stamp = 20;
+    frame.subjects["a_subject"].is_visible = true;
+    frame.subjects["foo"].global_pose = translation(2);
+    frame.subjects["foo"].is_visible = true;
+    history.add(FlatViconFrame(frame));
+
+    const FlatViconFrame::NameTable names = {"a_subject", "foo"};
+    auto pose = history.get_pose_at(names, 1, 15);
+    ASSERT_TRUE(pose);
+    ASSERT_MATRIX_ALMOST_EQUAL(pose->matrix(), translation(1.5).matrix());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
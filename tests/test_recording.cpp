@@ -0,0 +1,519 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for recording.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/recording.hpp>
+#include <vicon_transformer/vicon_receiver.hpp>
+
+#include "utils.hpp"
+
+using vicon_transformer::PlaybackReceiver;
+using vicon_transformer::RecordingReader;
+using vicon_transformer::RecordingWriter;
+using vicon_transformer::ViconFrame;
+
+namespace
+{
+// assumes test is executed in package root directory
+const std::string RECORDING_FILE = "tests/data/recording_3s.dat";
+
+//! Load all frames of the test recording.
+std::vector<ViconFrame> load_test_frames()
+{
+    PlaybackReceiver receiver(RECORDING_FILE);
+    std::vector<ViconFrame> frames;
+    while (true)
+    {
+        try
+        {
+            frames.push_back(receiver.read());
+        }
+        catch (const std::out_of_range &)
+        {
+            break;
+        }
+    }
+    return frames;
+}
+
+std::filesystem::path get_temp_file(const std::string &name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+void expect_frames_equal(const ViconFrame &a, const ViconFrame &b)
+{
+    EXPECT_EQ(a.frame_number, b.frame_number);
+    EXPECT_EQ(a.frame_rate, b.frame_rate);
+    EXPECT_EQ(a.latency, b.latency);
+    EXPECT_EQ(a.time_stamp, b.time_stamp);
+    ASSERT_EQ(a.subjects.size(), b.subjects.size());
+    for (const auto &[name, data] : a.subjects)
+    {
+        const auto &other = b.subjects.at(name);
+        EXPECT_EQ(data.is_visible, other.is_visible);
+        // values of invisible subjects are not stored in recordings
+        if (!data.is_visible)
+        {
+            continue;
+        }
+        EXPECT_EQ(data.quality, other.quality);
+        ASSERT_MATRIX_ALMOST_EQUAL(data.global_pose.matrix(),
+                                   other.global_pose.matrix());
+    }
+}
+
+//! Write the frames to a recording file.
+void write_recording(const std::filesystem::path &filename,
+                     const std::vector<ViconFrame> &frames,
+                     uint32_t frames_per_chunk)
+{
+    RecordingWriter writer(filename, frames_per_chunk);
+    for (const ViconFrame &frame : frames)
+    {
+        writer.write(frame);
+    }
+    writer.close();
+    EXPECT_EQ(writer.num_frames(), frames.size());
+}
+
+//! Flip one byte in the payload of the given chunk.
+void corrupt_chunk(const std::filesystem::path &filename, size_t chunk_index)
+{
+    uint64_t offset;
+    {
+        RecordingReader reader(filename);
+        offset = reader.chunks().at(chunk_index).offset;
+    }
+
+    std::fstream file(filename,
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekg(offset + 50);
+    char byte;
+    file.read(&byte, 1);
+    byte = ~byte;
+    file.seekp(offset + 50);
+    file.write(&byte, 1);
+}
+}  // namespace
+
+TEST(Recording, write_and_read)
+{
+    const auto filename = get_temp_file("test_recording_write_and_read.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    ASSERT_GT(frames.size(), 100u);
+
+    write_recording(filename, frames, 100);
+
+    ASSERT_TRUE(vicon_transformer::is_recording_file(filename));
+    RecordingReader reader(filename);
+    EXPECT_TRUE(reader.has_index());
+    EXPECT_EQ(reader.num_frames(), frames.size());
+    EXPECT_EQ(reader.chunks().size(), (frames.size() + 99) / 100);
+
+    const auto &first_chunk = reader.chunks().front();
+    EXPECT_EQ(first_chunk.num_frames, 100u);
+    EXPECT_EQ(first_chunk.first_frame_number, frames[0].frame_number);
+    EXPECT_EQ(first_chunk.last_frame_number, frames[99].frame_number);
+    EXPECT_EQ(first_chunk.first_time_stamp, frames[0].time_stamp);
+    EXPECT_EQ(first_chunk.last_time_stamp, frames[99].time_stamp);
+
+    std::vector<ViconFrame> loaded = reader.read_all();
+    ASSERT_EQ(loaded.size(), frames.size());
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        expect_frames_equal(loaded[i], frames[i]);
+    }
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, playback)
+{
+    const auto filename = get_temp_file("test_recording_playback.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(filename, frames, 64);
+
+    PlaybackReceiver receiver(filename);
+    for (const ViconFrame &frame : frames)
+    {
+        expect_frames_equal(receiver.read(), frame);
+    }
+    EXPECT_THROW(receiver.read(), std::out_of_range);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, truncated_file)
+{
+    const auto filename = get_temp_file("test_recording_truncated.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(filename, frames, 100);
+
+    // cut off the index and half of the last chunk, as if the recording
+    // process was killed
+    uint64_t last_chunk_offset;
+    {
+        RecordingReader reader(filename);
+        last_chunk_offset = reader.chunks().back().offset;
+    }
+    std::filesystem::resize_file(filename, last_chunk_offset + 100);
+
+    RecordingReader reader(filename);
+    EXPECT_FALSE(reader.has_index());
+    const size_t expected_frames = (frames.size() - 1) / 100 * 100;
+    EXPECT_EQ(reader.num_frames(), expected_frames);
+
+    std::vector<ViconFrame> loaded = reader.read_all();
+    ASSERT_EQ(loaded.size(), expected_frames);
+    expect_frames_equal(loaded.back(), frames[expected_frames - 1]);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, corrupted_chunk)
+{
+    const auto filename = get_temp_file("test_recording_corrupted.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(filename, frames, 100);
+    corrupt_chunk(filename, 1);
+
+    RecordingReader reader(filename);
+    ASSERT_TRUE(reader.has_index());
+    ViconFrame frame;
+    EXPECT_NO_THROW(reader.read_frame(0, frame));
+    EXPECT_THROW(reader.read_frame(100, frame), std::runtime_error);
+    EXPECT_NO_THROW(reader.read_frame(200, frame));
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, recover_truncated)
+{
+    const auto filename = get_temp_file("test_recording_recover_in.vrec");
+    const auto recovered = get_temp_file("test_recording_recover_out.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(filename, frames, 100);
+
+    // as if the recording process was killed while writing the third chunk
+    uint64_t offset;
+    {
+        RecordingReader reader(filename);
+        offset = reader.chunks().at(2).offset;
+    }
+    std::filesystem::resize_file(filename, offset + 100);
+    // ...and a chunk got damaged
+    corrupt_chunk(filename, 0);
+
+    auto result = vicon_transformer::recover_recording(filename, recovered);
+    EXPECT_FALSE(result.had_index);
+    EXPECT_EQ(result.num_frames, 100u);
+
+    RecordingReader reader(recovered);
+    EXPECT_TRUE(reader.has_index());
+    ASSERT_EQ(reader.num_frames(), 100u);
+    ViconFrame frame;
+    reader.read_frame(0, frame);
+    expect_frames_equal(frame, frames[100]);
+
+    std::filesystem::remove(filename);
+    std::filesystem::remove(recovered);
+}
+
+TEST(Recording, recover_with_index)
+{
+    const auto filename = get_temp_file("test_recording_recover_idx_in.vrec");
+    const auto recovered =
+        get_temp_file("test_recording_recover_idx_out.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(filename, frames, 100);
+    corrupt_chunk(filename, 1);
+
+    auto result = vicon_transformer::recover_recording(filename, recovered);
+    EXPECT_TRUE(result.had_index);
+    EXPECT_EQ(result.num_corrupted_chunks, 1u);
+    EXPECT_EQ(result.num_frames, frames.size() - 100);
+
+    RecordingReader reader(recovered);
+    EXPECT_EQ(reader.num_frames(), frames.size() - 100);
+    EXPECT_EQ(reader.frames_per_chunk(), 100u);
+
+    std::filesystem::remove(filename);
+    std::filesystem::remove(recovered);
+}
+
+TEST(Recording, read_frame)
+{
+    const auto filename = get_temp_file("test_recording_read_frame.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(filename, frames, 100);
+
+    RecordingReader reader(filename);
+    ViconFrame frame;
+
+    // random access in arbitrary order
+    for (size_t i : {size_t(150), size_t(0), frames.size() - 1, size_t(99),
+                     size_t(100), size_t(151)})
+    {
+        reader.read_frame(i, frame);
+        expect_frames_equal(frame, frames[i]);
+    }
+
+    EXPECT_THROW(reader.read_frame(frames.size(), frame), std::out_of_range);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, quantized)
+{
+    constexpr double step = 1e-6;
+    constexpr double rotation_step = 1e-7;
+    const auto filename = get_temp_file("test_recording_quantized.vrec");
+    const auto lossless_filename =
+        get_temp_file("test_recording_quantized_lossless.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(lossless_filename, frames, 100);
+
+    {
+        RecordingWriter writer(filename, 100, step, rotation_step);
+        for (const ViconFrame &frame : frames)
+        {
+            writer.write(frame);
+        }
+    }
+
+    EXPECT_LT(std::filesystem::file_size(filename),
+              std::filesystem::file_size(RECORDING_FILE) / 5);
+    EXPECT_LT(std::filesystem::file_size(filename),
+              std::filesystem::file_size(lossless_filename));
+
+    RecordingReader reader(filename);
+    EXPECT_EQ(reader.quantization_step(), step);
+    EXPECT_EQ(reader.rotation_quantization_step(), rotation_step);
+    std::vector<ViconFrame> result = reader.read_all();
+    ASSERT_EQ(result.size(), frames.size());
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        EXPECT_EQ(result[i].frame_number, frames[i].frame_number);
+        EXPECT_EQ(result[i].time_stamp, frames[i].time_stamp);
+        for (const auto &[name, subject] : frames[i].subjects)
+        {
+            if (!subject.is_visible)
+            {
+                continue;
+            }
+            const auto &pose = result[i].subjects.at(name).global_pose;
+            EXPECT_LE((pose.translation - subject.global_pose.translation)
+                          .cwiseAbs()
+                          .maxCoeff(),
+                      step);
+            EXPECT_LE(
+                pose.rotation.angularDistance(subject.global_pose.rotation),
+                4 * rotation_step);
+        }
+    }
+
+    std::filesystem::remove(filename);
+    std::filesystem::remove(lossless_filename);
+}
+
+TEST(Recording, find_frame)
+{
+    const auto filename = get_temp_file("test_recording_find_frame.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(filename, frames, 100);
+
+    RecordingReader reader(filename);
+    for (size_t i : {size_t(0), size_t(42), size_t(99), size_t(100),
+                     frames.size() - 1})
+    {
+        EXPECT_EQ(reader.find_frame_number(frames[i].frame_number), i);
+        EXPECT_EQ(reader.find_time_stamp(frames[i].time_stamp), i);
+        // in between two frames -> next frame
+        EXPECT_EQ(reader.find_time_stamp(frames[i].time_stamp - 1), i);
+    }
+
+    EXPECT_EQ(reader.find_frame_number(frames.front().frame_number - 10), 0u);
+    EXPECT_EQ(reader.find_frame_number(frames.back().frame_number + 1),
+              frames.size());
+    EXPECT_EQ(reader.find_time_stamp(frames.back().time_stamp + 1),
+              frames.size());
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, playback_seek)
+{
+    const auto filename = get_temp_file("test_recording_playback_seek.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    write_recording(filename, frames, 100);
+
+    PlaybackReceiver receiver(filename);
+    ASSERT_EQ(receiver.num_frames(), frames.size());
+
+    receiver.seek_to_frame(frames[250].frame_number);
+    EXPECT_EQ(receiver.current_index(), 250u);
+    expect_frames_equal(receiver.read(), frames[250]);
+
+    receiver.seek_to_time(frames[17].time_stamp);
+    expect_frames_equal(receiver.read(), frames[17]);
+    expect_frames_equal(receiver.read(), frames[18]);
+
+    EXPECT_THROW(receiver.seek_to_time(frames.back().time_stamp + 1),
+                 std::out_of_range);
+
+    std::vector<ViconFrame> range =
+        receiver.read_range(frames[95].time_stamp, frames[205].time_stamp);
+    ASSERT_EQ(range.size(), 110u);
+    expect_frames_equal(range.front(), frames[95]);
+    expect_frames_equal(range.back(), frames[204]);
+    // position is not changed
+    EXPECT_EQ(receiver.current_index(), 19u);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, convert_to_recording)
+{
+    const auto filename = get_temp_file("test_recording_convert.vrec");
+    vicon_transformer::convert_to_recording(RECORDING_FILE, filename, 50);
+
+    std::vector<ViconFrame> frames = load_test_frames();
+    RecordingReader reader(filename);
+    ASSERT_EQ(reader.num_frames(), frames.size());
+    std::vector<ViconFrame> converted = reader.read_all();
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        expect_frames_equal(converted[i], frames[i]);
+    }
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, convert_parallel)
+{
+    const auto filename = get_temp_file("test_recording_convert_par.vrec");
+    const auto requantized =
+        get_temp_file("test_recording_convert_requantized.vrec");
+    vicon_transformer::convert_to_recording(
+        RECORDING_FILE, filename, 20, 0, 0, 4);
+
+    std::vector<ViconFrame> frames = load_test_frames();
+    {
+        RecordingReader reader(filename);
+        ASSERT_EQ(reader.num_frames(), frames.size());
+        EXPECT_EQ(reader.chunks().size(), (frames.size() + 19) / 20);
+        std::vector<ViconFrame> converted = reader.read_all();
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            expect_frames_equal(converted[i], frames[i]);
+        }
+    }
+
+    // convert a recording of the current format (chunks are kept)
+    constexpr double step = 1e-6;
+    vicon_transformer::convert_to_recording(
+        filename, requantized, 300, step, step / 10, 3);
+    RecordingReader reader(requantized);
+    ASSERT_EQ(reader.num_frames(), frames.size());
+    EXPECT_EQ(reader.chunks().size(), (frames.size() + 19) / 20);
+    EXPECT_EQ(reader.quantization_step(), step);
+    EXPECT_EQ(reader.rotation_quantization_step(), step / 10);
+    EXPECT_LT(std::filesystem::file_size(requantized),
+              std::filesystem::file_size(filename));
+    std::vector<ViconFrame> converted = reader.read_all();
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        EXPECT_EQ(converted[i].frame_number, frames[i].frame_number);
+        EXPECT_EQ(converted[i].time_stamp, frames[i].time_stamp);
+        ASSERT_EQ(converted[i].subjects.size(), frames[i].subjects.size());
+    }
+
+    std::filesystem::remove(filename);
+    std::filesystem::remove(requantized);
+}
+
+TEST(Recording, convert_truncated_input)
+{
+    const auto truncated = get_temp_file("test_recording_truncated.dat");
+    const auto filename = get_temp_file("test_recording_convert_trunc.vrec");
+    std::filesystem::copy_file(
+        RECORDING_FILE,
+        truncated,
+        std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file(truncated,
+                                 std::filesystem::file_size(truncated) / 2);
+
+    EXPECT_THROW(
+        vicon_transformer::convert_to_recording(truncated, filename, 20),
+        std::runtime_error);
+    // no incomplete output that looks like a valid recording is left
+    EXPECT_FALSE(std::filesystem::exists(filename));
+
+    std::filesystem::remove(truncated);
+}
+
+TEST(Recording, abort)
+{
+    const auto filename = get_temp_file("test_recording_abort.vrec");
+    std::vector<ViconFrame> frames = load_test_frames();
+    {
+        RecordingWriter writer(filename, 100);
+        for (size_t i = 0; i < 150; i++)
+        {
+            writer.write(frames.at(i));
+        }
+        writer.abort();
+    }
+
+    // the file has no index, so it is not mistaken for a complete recording,
+    // and the incomplete chunk is dropped
+    RecordingReader reader(filename);
+    EXPECT_FALSE(reader.has_index());
+    EXPECT_EQ(reader.num_frames(), 100u);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, decode_chunk)
+{
+    const auto filename = get_temp_file("test_recording_decode_chunk.vrec");
+    vicon_transformer::convert_to_recording(RECORDING_FILE, filename, 50);
+
+    std::vector<ViconFrame> frames = load_test_frames();
+    RecordingReader reader(filename);
+    std::vector<ViconFrame> chunk;
+    reader.decode_chunk(2, chunk);
+    ASSERT_EQ(chunk.size(), 50u);
+    for (size_t i = 0; i < chunk.size(); i++)
+    {
+        expect_frames_equal(chunk[i], frames[100 + i]);
+    }
+    EXPECT_THROW(reader.decode_chunk(reader.chunks().size(), chunk),
+                 std::out_of_range);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(Recording, not_a_recording)
+{
+    EXPECT_FALSE(vicon_transformer::is_recording_file(RECORDING_FILE));
+    EXPECT_THROW(RecordingReader reader(RECORDING_FILE), std::runtime_error);
+    EXPECT_THROW(RecordingReader reader("tests/data/does_not_exist.vrec"),
+                 std::runtime_error);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for shared_memory_broadcast.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/shared_memory_broadcast.hpp>
+
+using vicon_transformer::SharedMemoryPublisher;
+using vicon_transformer::SharedMemoryReceiver;
+using vicon_transformer::ViconFrame;
+
+namespace
+{
+//! Name that does not collide with tests running in parallel.
+std::string get_test_name(const std::string &test)
+{
+    return "vicon_transformer_test_" + test + "_" + std::to_string(getpid());
+}
+
+//! Create a frame whose content depends on i.
+ViconFrame make_frame(int i)
+{
+    ViconFrame frame;
+    frame.frame_number = i;
+    frame.time_stamp = 1000 * i;
+    frame.latency = 0.01 * i;
+    frame.subjects["ball"].is_visible = true;
+    frame.subjects["ball"].global_pose.translation << i, 2 * i, 3 * i;
+    frame.subjects["racket"].is_visible = (i % 2 == 0);
+    frame.subjects["racket"].quality = i;
+    return frame;
+}
+
+void expect_frame(const ViconFrame &frame, int i)
+{
+    EXPECT_EQ(frame.frame_number, i);
+    EXPECT_EQ(frame.time_stamp, 1000 * i);
+    EXPECT_EQ(frame.latency, 0.01 * i);
+    ASSERT_EQ(frame.subjects.size(), 2u);
+    EXPECT_TRUE(frame.subjects.at("ball").is_visible);
+    EXPECT_EQ(frame.subjects.at("ball").global_pose.translation.y(), 2 * i);
+    EXPECT_EQ(frame.subjects.at("racket").is_visible, i % 2 == 0);
+    EXPECT_EQ(frame.subjects.at("racket").quality, i);
+}
+}  // namespace
+
+TEST(SharedMemoryBroadcast, no_publisher)
+{
+    EXPECT_THROW(SharedMemoryReceiver(get_test_name("no_publisher")),
+                 std::runtime_error);
+}
+
+TEST(SharedMemoryBroadcast, invalid_arguments)
+{
+    const std::string name = get_test_name("invalid_arguments");
+    EXPECT_THROW(SharedMemoryPublisher(name, 0), std::invalid_argument);
+    EXPECT_THROW(SharedMemoryPublisher(name, 4, 0), std::invalid_argument);
+
+    SharedMemoryPublisher publisher(name, 4, 16);
+    EXPECT_THROW(publisher.publish(make_frame(1)), std::length_error);
+}
+
+TEST(SharedMemoryBroadcast, name_in_use)
+{
+    const std::string name = get_test_name("name_in_use");
+    auto publisher1 = std::make_unique<SharedMemoryPublisher>(name);
+    publisher1->publish(make_frame(1));
+
+    // the memory of a running publisher is not replaced by accident
+    EXPECT_THROW(SharedMemoryPublisher{name}, std::runtime_error);
+    SharedMemoryReceiver receiver1(name);
+    expect_frame(receiver1.read(), 1);
+
+    // ...but it can be taken over explicitly (e.g. if the publisher crashed)
+    SharedMemoryPublisher publisher2(name, 8, 4096, true);
+    publisher2.publish(make_frame(2));
+    SharedMemoryReceiver receiver2(name);
+    expect_frame(receiver2.read(), 2);
+
+    // destroying the old publisher does not remove the new memory
+    publisher1.reset();
+    EXPECT_TRUE(receiver1.is_publisher_closed());
+    EXPECT_FALSE(receiver2.is_publisher_closed());
+    publisher2.publish(make_frame(3));
+    SharedMemoryReceiver receiver3(name);
+    expect_frame(receiver3.read(), 3);
+}
+
+TEST(SharedMemoryBroadcast, read_newest)
+{
+    const std::string name = get_test_name("read_newest");
+    SharedMemoryPublisher publisher(name);
+    SharedMemoryReceiver receiver(name);
+
+    ViconFrame frame;
+    EXPECT_FALSE(receiver.try_read_into(frame));
+
+    for (int i = 0; i < 5; i++)
+    {
+        publisher.publish(make_frame(i));
+    }
+    receiver.read_into(frame);
+    expect_frame(frame, 4);
+    EXPECT_EQ(receiver.num_dropped_frames(), 0u);
+    EXPECT_FALSE(receiver.try_read_into(frame));
+
+    for (int i = 5; i < 8; i++)
+    {
+        publisher.publish(make_frame(i));
+    }
+    expect_frame(receiver.read(), 7);
+    EXPECT_EQ(receiver.num_dropped_frames(), 2u);
+}
+
+TEST(SharedMemoryBroadcast, read_all_frames)
+{
+    const std::string name = get_test_name("read_all_frames");
+    SharedMemoryPublisher publisher(name, 4);
+    SharedMemoryReceiver receiver(name, true);
+
+    publisher.publish(make_frame(0));
+    expect_frame(receiver.read(), 0);
+
+    for (int i = 1; i < 4; i++)
+    {
+        publisher.publish(make_frame(i));
+    }
+    for (int i = 1; i < 4; i++)
+    {
+        expect_frame(receiver.read(), i);
+    }
+    EXPECT_EQ(receiver.num_dropped_frames(), 0u);
+
+    // lag behind by more than the size of the ring buffer
+    for (int i = 4; i < 10; i++)
+    {
+        publisher.publish(make_frame(i));
+    }
+    expect_frame(receiver.read(), 6);
+    EXPECT_EQ(receiver.num_dropped_frames(), 2u);
+}
+
+TEST(SharedMemoryBroadcast, multiple_receivers)
+{
+    const std::string name = get_test_name("multiple_receivers");
+    SharedMemoryPublisher publisher(name);
+    SharedMemoryReceiver receiver1(name);
+
+    publisher.publish(make_frame(0));
+    {
+        SharedMemoryReceiver receiver2(name);
+        expect_frame(receiver2.read(), 0);
+    }
+    expect_frame(receiver1.read(), 0);
+
+    publisher.publish(make_frame(1));
+    SharedMemoryReceiver receiver3(name);
+    expect_frame(receiver3.read(), 1);
+    expect_frame(receiver1.read(), 1);
+}
+
+TEST(SharedMemoryBroadcast, publisher_closed)
+{
+    const std::string name = get_test_name("publisher_closed");
+    auto publisher = std::make_unique<SharedMemoryPublisher>(name);
+    SharedMemoryReceiver receiver(name);
+
+    publisher->publish(make_frame(0));
+    publisher.reset();
+
+    EXPECT_TRUE(receiver.is_publisher_closed());
+    // frames published before closing can still be read
+    expect_frame(receiver.read(), 0);
+    EXPECT_THROW(receiver.read(), std::runtime_error);
+
+    // the shared memory is removed
+    EXPECT_THROW(SharedMemoryReceiver{name}, std::runtime_error);
+}
+
+TEST(SharedMemoryBroadcast, publisher_crashed)
+{
+    const std::string name = get_test_name("publisher_crashed");
+
+    // publisher in a child process that exits without cleaning up
+    pid_t pid = fork();
+    ASSERT_NE(pid, -1);
+    if (pid == 0)
+    {
+        auto publisher = new SharedMemoryPublisher(name);
+        publisher->publish(make_frame(0));
+        _exit(0);
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+
+    SharedMemoryReceiver receiver(name);
+    EXPECT_FALSE(receiver.is_publisher_closed());
+    EXPECT_FALSE(receiver.is_publisher_alive());
+    // read() does not block forever
+    expect_frame(receiver.read(), 0);
+    EXPECT_THROW(receiver.read(), std::runtime_error);
+
+    // the memory of the crashed publisher can be replaced without take_over
+    SharedMemoryPublisher publisher(name);
+    SharedMemoryReceiver receiver2(name);
+    EXPECT_TRUE(receiver2.is_publisher_alive());
+}
+
+TEST(SharedMemoryBroadcast, concurrent_access)
+{
+    constexpr int NUM_FRAMES = 20000;
+    const std::string name = get_test_name("concurrent_access");
+    SharedMemoryPublisher publisher(name, 4);
+    SharedMemoryReceiver receiver(name, true);
+
+    std::thread writer(
+        [&publisher]
+        {
+            for (int i = 0; i < NUM_FRAMES; i++)
+            {
+                publisher.publish(make_frame(i));
+            }
+        });
+
+    // frames are always consistent and in order, but some may be dropped as
+    // the ring buffer is small
+    int previous = -1;
+    ViconFrame frame;
+    while (previous < NUM_FRAMES - 1)
+    {
+        receiver.read_into(frame);
+        ASSERT_GT(frame.frame_number, previous);
+        expect_frame(frame, frame.frame_number);
+        previous = frame.frame_number;
+    }
+    writer.join();
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for subject_registry.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <array>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/errors.hpp>
+#include <vicon_transformer/subject_registry.hpp>
+
+using vicon_transformer::SubjectRegistry;
+
+namespace
+{
+struct TestSubjects
+{
+    static constexpr std::array<std::string_view, 5> names = {
+        "rll_ping_base", "Marker_Arm", "ball_launcher", "TT Platte", "a"};
+};
+
+struct NoSubjects
+{
+    static constexpr std::array<std::string_view, 0> names = {};
+};
+
+using Registry = SubjectRegistry<TestSubjects>;
+
+// lookup is possible at compile time
+static_assert(Registry::size == 5);
+static_assert(Registry::index_of("ball_launcher") == 2);
+static_assert(Registry::name(3) == "TT Platte");
+static_assert(!Registry::find("unknown"));
+}  // namespace
+
+TEST(SubjectRegistry, index_of)
+{
+    for (size_t i = 0; i < Registry::size; i++)
+    {
+        EXPECT_EQ(Registry::index_of(Registry::name(i)), i);
+        EXPECT_EQ(Registry::map_name_to_index(std::string(Registry::name(i))),
+                  i);
+        EXPECT_EQ(Registry::names()[i], TestSubjects::names[i]);
+    }
+}
+
+TEST(SubjectRegistry, unknown_subject)
+{
+    EXPECT_FALSE(Registry::find(""));
+    EXPECT_FALSE(Registry::find("Marker_Ar"));
+    EXPECT_FALSE(Registry::find("zzz"));
+    EXPECT_THROW(Registry::index_of("Marker_Ar"),
+                 vicon_transformer::UnknownSubjectError);
+    EXPECT_THROW(Registry::map_name_to_index("foo"),
+                 vicon_transformer::UnknownSubjectError);
+}
+
+TEST(SubjectRegistry, empty)
+{
+    using EmptyRegistry = SubjectRegistry<NoSubjects>;
+    EXPECT_EQ(EmptyRegistry::size, 0u);
+    EXPECT_FALSE(EmptyRegistry::find("foo"));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
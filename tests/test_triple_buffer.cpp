@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+/**
+ * @file
+ * @brief Tests for triple_buffer.hpp
+ * @copyright 2023, Max Planck Gesellschaft.  All rights reserved.
+ */
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <vicon_transformer/triple_buffer.hpp>
+
+using vicon_transformer::TripleBuffer;
+
+TEST(TripleBuffer, no_data)
+{
+    TripleBuffer<int> buffer;
+
+    EXPECT_FALSE(buffer.has_new_data());
+    EXPECT_FALSE(buffer.swap());
+}
+
+TEST(TripleBuffer, publish_and_swap)
+{
+    TripleBuffer<int> buffer;
+
+    buffer.write_buffer() = 42;
+    buffer.publish();
+
+    EXPECT_TRUE(buffer.has_new_data());
+    EXPECT_TRUE(buffer.swap());
+    EXPECT_EQ(buffer.read_buffer(), 42);
+
+    // nothing new was published, so read buffer must not change
+    EXPECT_FALSE(buffer.has_new_data());
+    EXPECT_FALSE(buffer.swap());
+    EXPECT_EQ(buffer.read_buffer(), 42);
+}
+
+TEST(TripleBuffer, only_latest_value_is_read)
+{
+    TripleBuffer<int> buffer;
+
+    for (int i = 1; i <= 5; i++)
+    {
+        buffer.write_buffer() = i;
+        buffer.publish();
+    }
+
+    EXPECT_TRUE(buffer.swap());
+    EXPECT_EQ(buffer.read_buffer(), 5);
+    EXPECT_FALSE(buffer.swap());
+}
+
+TEST(TripleBuffer, concurrent_access)
+{
+    // Writer publishes increasing values, reader verifies that it never sees
+    // them out of order or torn.
+    constexpr int N = 100000;
+    TripleBuffer<std::pair<int, int>> buffer;
+
+    std::thread writer(
+        [&buffer]
+        {
+            for (int i = 1; i <= N; i++)
+            {
+                buffer.write_buffer() = {i, -i};
+                buffer.publish();
+            }
+        });
+
+    int last = 0;
+    while (last < N)
+    {
+        if (buffer.swap())
+        {
+            auto [value, negated] = buffer.read_buffer();
+            ASSERT_GT(value, last);
+            ASSERT_EQ(value, -negated);
+            last = value;
+        }
+    }
+
+    writer.join();
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -5,7 +5,13 @@
  * @brief Tests for vicon_receiver.hpp
  * @copyright 2022, Max Planck Gesellschaft.  All rights reserved.
  */
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <utility>
+
 #include <gtest/gtest.h>
+#include <cereal/archives/binary.hpp>
 
 #include <serialization_utils/cereal_json.hpp>
 
@@ -13,6 +19,7 @@
 
 #include "utils.hpp"
 
+using vicon_transformer::FlatViconFrame;
 using vicon_transformer::JsonReceiver;
 using vicon_transformer::PlaybackReceiver;
 using vicon_transformer::ViconFrame;
@@ -65,6 +72,128 @@ TEST(ViconFrame, serialize)
                                arm2.global_pose.translation);
 }
 
+TEST(FlatViconFrame, convert)
+{
+    JsonReceiver receiver("tests/data/test_frame1.json");
+    ViconFrame frame = receiver.read();
+
+    FlatViconFrame flat(frame);
+    EXPECT_EQ(flat.frame_number, frame.frame_number);
+    EXPECT_EQ(flat.time_stamp, frame.time_stamp);
+    ASSERT_EQ(flat.num_subjects(), frame.subjects.size());
+
+    size_t i = 0;
+    for (const auto &[name, data] : frame.subjects)
+    {
+        EXPECT_EQ(flat.subject_names->at(i), name);
+        EXPECT_EQ(flat.find_subject(name), i);
+        EXPECT_EQ(flat.subjects[i].quality, data.quality);
+        i++;
+    }
+    EXPECT_EQ(flat.find_subject("foo"), std::nullopt);
+
+    ViconFrame frame2 = flat.to_vicon_frame();
+    EXPECT_EQ(frame2.frame_number, frame.frame_number);
+    ASSERT_EQ(frame2.subjects.size(), frame.subjects.size());
+    EXPECT_EQ(frame2.subjects.at("Marker_Arm").quality,
+              frame.subjects.at("Marker_Arm").quality);
+}
+
+TEST(FlatViconFrame, to_vicon_frame_size_mismatch)
+{
+    JsonReceiver receiver("tests/data/test_frame1.json");
+    FlatViconFrame flat(receiver.read());
+
+    flat.subjects.pop_back();
+    EXPECT_THROW(flat.to_vicon_frame(), std::invalid_argument);
+
+    flat.subjects.resize(flat.subject_names->size() + 1);
+    EXPECT_THROW(flat.to_vicon_frame(), std::invalid_argument);
+}
+
+TEST(FlatViconFrame, name_table_is_reused)
+{
+    JsonReceiver receiver1("tests/data/test_frame1.json");
+    JsonReceiver receiver2("tests/data/test_frame2.json");
+
+    FlatViconFrame flat(receiver1.read());
+    auto names = flat.subject_names;
+
+    // same set of subjects -> same table
+    flat.assign(receiver2.read());
+    EXPECT_EQ(flat.subject_names, names);
+
+    // different subjects -> new table
+    ViconFrame frame = receiver2.read();
+    frame.subjects["foo"] = vicon_transformer::SubjectData();
+    flat.assign(frame);
+    EXPECT_NE(flat.subject_names, names);
+    EXPECT_EQ(flat.num_subjects(), names->size() + 1);
+    EXPECT_EQ(flat.num_subjects(), flat.subject_names->size());
+    EXPECT_TRUE(flat.find_subject("foo"));
+}
+
+TEST(FlatViconFrame, serialize)
+{
+    JsonReceiver receiver("tests/data/test_frame1.json");
+    FlatViconFrame frame1(receiver.read());
+
+    std::stringstream stream;
+    {
+        cereal::BinaryOutputArchive archive(stream);
+        archive(frame1);
+    }
+    FlatViconFrame frame2;
+    {
+        cereal::BinaryInputArchive archive(stream);
+        archive(frame2);
+    }
+
+    EXPECT_EQ(frame1.frame_number, frame2.frame_number);
+    EXPECT_EQ(frame1.frame_rate, frame2.frame_rate);
+    EXPECT_EQ(frame1.time_stamp, frame2.time_stamp);
+    EXPECT_EQ(frame1.latency, frame2.latency);
+    EXPECT_EQ(*frame1.subject_names, *frame2.subject_names);
+    ASSERT_EQ(frame1.num_subjects(), frame2.num_subjects());
+    for (size_t i = 0; i < frame1.num_subjects(); i++)
+    {
+        EXPECT_EQ(frame1.subjects[i].is_visible, frame2.subjects[i].is_visible);
+        EXPECT_EQ(frame1.subjects[i].quality, frame2.subjects[i].quality);
+        ASSERT_MATRIX_ALMOST_EQUAL(frame1.subjects[i].global_pose.matrix(),
+                                   frame2.subjects[i].global_pose.matrix());
+    }
+}
+
+TEST(FlatViconFrame, load_rejects_invalid_name_table)
+{
+    JsonReceiver receiver("tests/data/test_frame1.json");
+    FlatViconFrame frame(receiver.read());
+    ASSERT_GE(frame.num_subjects(), 2u);
+
+    auto expect_load_throws = [&frame](FlatViconFrame::NameTable names)
+    {
+        frame.subject_names =
+            std::make_shared<const FlatViconFrame::NameTable>(std::move(names));
+
+        std::stringstream stream;
+        {
+            cereal::BinaryOutputArchive archive(stream);
+            archive(frame);
+        }
+        FlatViconFrame loaded;
+        cereal::BinaryInputArchive archive(stream);
+        EXPECT_THROW(archive(loaded), std::runtime_error);
+    };
+
+    FlatViconFrame::NameTable unsorted = *frame.subject_names;
+    std::swap(unsorted[0], unsorted[1]);
+    expect_load_throws(unsorted);
+
+    FlatViconFrame::NameTable duplicate = *frame.subject_names;
+    duplicate[1] = duplicate[0];
+    expect_load_throws(duplicate);
+}
+
 TEST(PlaybackReceiver, load_and_playback)
 {
     // assumes test is executed in package root directory
@@ -99,6 +228,184 @@ TEST(PlaybackReceiver, load_and_playback)
         std::out_of_range);
 }
 
+TEST(PlaybackReceiver, read_into)
+{
+    // assumes test is executed in package root directory
+    std::string file = "tests/data/recording_3s.dat";
+
+    PlaybackReceiver receiver1(file);
+    PlaybackReceiver receiver2(file);
+
+    ViconFrame frame;
+    receiver2.read_into(frame);
+    // keep pointer to a subject entry to verify that it is updated in place
+    const vicon_transformer::SubjectData* arm = &frame.subjects.at("Marker_Arm");
+
+    for (int i = 0; i < 10; i++)
+    {
+        if (i > 0)
+        {
+            receiver2.read_into(frame);
+        }
+        ViconFrame expected = receiver1.read();
+
+        EXPECT_EQ(frame.frame_number, expected.frame_number);
+        EXPECT_EQ(frame.time_stamp, expected.time_stamp);
+        EXPECT_EQ(frame.subjects.size(), expected.subjects.size());
+        EXPECT_EQ(arm, &frame.subjects.at("Marker_Arm"));
+        EXPECT_EQ(arm->quality, expected.subjects.at("Marker_Arm").quality);
+    }
+}
+
+TEST(PlaybackReceiver, seek)
+{
+    // assumes test is executed in package root directory
+    std::string file = "tests/data/recording_3s.dat";
+
+    PlaybackReceiver receiver(file);
+    ViconFrame first = receiver.read();
+    ViconFrame second = receiver.read();
+    ViconFrame third = receiver.read();
+
+    receiver.seek_to_frame(second.frame_number);
+    EXPECT_EQ(receiver.read().frame_number, second.frame_number);
+
+    receiver.seek_to_time(first.time_stamp);
+    EXPECT_EQ(receiver.read().frame_number, first.frame_number);
+
+    std::vector<ViconFrame> range =
+        receiver.read_range(second.time_stamp, third.time_stamp + 1);
+    ASSERT_EQ(range.size(), 2u);
+    EXPECT_EQ(range[0].frame_number, second.frame_number);
+    EXPECT_EQ(range[1].frame_number, third.frame_number);
+
+    EXPECT_THROW(receiver.seek_to_frame(std::numeric_limits<int>::max()),
+                 std::out_of_range);
+}
+
+TEST(PlaybackReceiver, paced_playback)
+{
+    // assumes test is executed in package root directory
+    std::string file = "tests/data/recording_3s.dat";
+
+    PlaybackReceiver receiver(file);
+    EXPECT_EQ(receiver.get_playback_speed(), 0.0);
+    EXPECT_THROW(receiver.set_playback_speed(0.01), std::invalid_argument);
+    EXPECT_THROW(receiver.set_playback_speed(1000), std::invalid_argument);
+    EXPECT_THROW(receiver.set_playback_speed(-1), std::invalid_argument);
+
+    // play back at 10x speed, so the test does not take too long
+    constexpr double speed = 10.0;
+    constexpr int num_frames = 30;
+    receiver.set_playback_speed(speed);
+
+    auto start = std::chrono::steady_clock::now();
+    ViconFrame first = receiver.read();
+    ViconFrame frame;
+    for (int i = 1; i < num_frames; i++)
+    {
+        receiver.read_into(frame);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    using nanoseconds = std::chrono::duration<double, std::nano>;
+    const double expected_ns = (frame.time_stamp - first.time_stamp) / speed;
+    EXPECT_GE(nanoseconds(elapsed).count(), expected_ns);
+
+    // seeking resets the pacing, so the next frame is returned immediately
+    receiver.seek_to_time(first.time_stamp);
+    start = std::chrono::steady_clock::now();
+    receiver.read();
+    elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, std::chrono::milliseconds(100));
+}
+
+TEST(PlaybackReceiver, rewrite_time_stamps)
+{
+    // assumes test is executed in package root directory
+    std::string file = "tests/data/recording_3s.dat";
+
+    PlaybackReceiver receiver(file);
+    ViconFrame original = receiver.read();
+
+    receiver.seek_to_frame(original.frame_number);
+    receiver.set_rewrite_time_stamps(true);
+    const int64_t before =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    ViconFrame frame = receiver.read();
+
+    EXPECT_EQ(frame.frame_number, original.frame_number);
+    EXPECT_GE(frame.time_stamp, before);
+}
+
+TEST(copy_frame, different_subjects)
+{
+    JsonReceiver receiver("tests/data/frame_with_missing_subjects.json");
+    ViconFrame source = receiver.read();
+
+    ViconFrame target;
+    target.subjects["foo"].quality = 42;
+    vicon_transformer::copy_frame(source, target);
+
+    EXPECT_EQ(target.frame_number, source.frame_number);
+    EXPECT_EQ(target.subjects.size(), source.subjects.size());
+    EXPECT_EQ(target.subjects.count("foo"), 0);
+    EXPECT_EQ(target.subjects.at("Marker_Arm").quality,
+              source.subjects.at("Marker_Arm").quality);
+}
+
+TEST(PackedViconFrame, pack_and_unpack)
+{
+    JsonReceiver receiver("tests/data/frame_with_missing_subjects.json");
+    ViconFrame source = receiver.read();
+    ASSERT_GE(source.subjects.size(), 3u);
+
+    vicon_transformer::FixedSizeViconFrame<3> frame;
+    frame.frame_number = source.frame_number;
+    frame.frame_rate = source.frame_rate;
+    frame.latency = source.latency;
+    frame.time_stamp = source.time_stamp;
+    frame.age_ns = 1234;
+    frame.frames_missed = 5;
+    frame.subjects[0] = source.subjects.at("Marker_Arm");
+    frame.subjects[1] = source.subjects.at("rll_led_stick");  // not visible
+    frame.subjects[2] = source.subjects.at("Marker Ballmaschine");
+
+    vicon_transformer::PackedViconFrame<3> packed(frame);
+    EXPECT_EQ(packed.num_subjects, 3u);
+    EXPECT_EQ(packed.frame_number, frame.frame_number);
+    EXPECT_EQ(packed.time_stamp, frame.time_stamp);
+    EXPECT_EQ(packed.age_ns, 1234);
+    EXPECT_EQ(packed.frames_missed, 5u);
+    EXPECT_EQ(packed.subjects[0].is_visible, 1);
+    EXPECT_EQ(packed.subjects[0].translation[2],
+              frame.subjects[0].global_pose.translation.z());
+    EXPECT_EQ(packed.subjects[0].rotation[3],
+              frame.subjects[0].global_pose.rotation.w());
+    // values of invisible subjects are zero
+    EXPECT_EQ(packed.subjects[1].is_visible, 0);
+    EXPECT_EQ(packed.subjects[1].translation[0], 0.0);
+    EXPECT_EQ(packed.subjects[1].quality, 0.0);
+
+    vicon_transformer::FixedSizeViconFrame<3> unpacked = packed.unpack();
+    EXPECT_EQ(unpacked.frame_number, frame.frame_number);
+    EXPECT_EQ(unpacked.frame_rate, frame.frame_rate);
+    EXPECT_EQ(unpacked.latency, frame.latency);
+    EXPECT_EQ(unpacked.time_stamp, frame.time_stamp);
+    EXPECT_EQ(unpacked.age_ns, frame.age_ns);
+    EXPECT_EQ(unpacked.frames_missed, frame.frames_missed);
+    for (size_t i : {0, 2})
+    {
+        EXPECT_TRUE(unpacked.subjects[i].is_visible);
+        EXPECT_EQ(unpacked.subjects[i].quality, frame.subjects[i].quality);
+        ASSERT_MATRIX_ALMOST_EQUAL(unpacked.subjects[i].global_pose.matrix(),
+                                   frame.subjects[i].global_pose.matrix());
+    }
+    EXPECT_FALSE(unpacked.subjects[1].is_visible);
+}
+
 TEST(PlaybackReceiver, file_not_found)
 {
     std::string file = "tests/data/this_does_not_exists.dat";
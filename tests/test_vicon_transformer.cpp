@@ -137,6 +137,60 @@ TEST(ViconTransformer, subject_not_visible_error)
                  vicon_transformer::SubjectNotVisibleError);
 }
 
+TEST(ViconTransformer, try_get_transform)
+{
+    ViconTransformer vtf(get_receiver("frame_with_missing_subjects.json"),
+                         "Marker Ballmaschine");
+    vtf.update();
+
+    auto tf = vtf.try_get_transform("Marker_Arm");
+    auto tf_raw = vtf.try_get_raw_transform("Marker_Arm");
+    ASSERT_TRUE(tf);
+    ASSERT_TRUE(tf_raw);
+    ASSERT_MATRIX_ALMOST_EQUAL(tf->matrix(),
+                               vtf.get_transform("Marker_Arm").matrix());
+    ASSERT_MATRIX_ALMOST_EQUAL(tf_raw->matrix(),
+                               vtf.get_raw_transform("Marker_Arm").matrix());
+
+    // not visible
+    EXPECT_FALSE(vtf.try_get_transform("rll_led_stick"));
+    EXPECT_FALSE(vtf.try_get_raw_transform("rll_led_stick"));
+    // unknown
+    EXPECT_FALSE(vtf.try_get_transform("foo"));
+    EXPECT_FALSE(vtf.try_get_raw_transform("foo"));
+
+    // handle-based
+    auto arm = vtf.resolve("Marker_Arm");
+    auto stick = vtf.resolve("rll_led_stick");
+    ASSERT_TRUE(vtf.try_get_transform(arm));
+    ASSERT_MATRIX_ALMOST_EQUAL(vtf.try_get_transform(arm)->matrix(),
+                               tf->matrix());
+    EXPECT_FALSE(vtf.try_get_transform(stick));
+    EXPECT_FALSE(vtf.try_get_raw_transform(stick));
+    EXPECT_FALSE(vtf.try_get_transform(vicon_transformer::SubjectHandle()));
+}
+
+TEST(ViconTransformer, origin_not_visible)
+{
+    ViconTransformer vtf(get_receiver("frame_with_missing_subjects.json"),
+                         "rll_led_stick");
+    EXPECT_THROW(vtf.update(), vicon_transformer::SubjectNotVisibleError);
+
+    ViconTransformer vtf2(get_receiver("frame_with_missing_subjects.json"),
+                          "foo");
+    EXPECT_THROW(vtf2.update(), vicon_transformer::UnknownSubjectError);
+    EXPECT_THROW(vtf2.wait_for_origin_subject_data(),
+                 vicon_transformer::UnknownSubjectError);
+}
+
+TEST(ViconTransformer, wait_for_origin_subject_data)
+{
+    ViconTransformer vtf(get_receiver("test_frame1.json"), "rll_ping_base");
+    vtf.wait_for_origin_subject_data();
+
+    ASSERT_EQ(vtf.get_timestamp_ns(), 1638538681615901200);
+}
+
 TEST(ViconTransformer, origin_transform)
 {
     // Load two different test frames of the same scene but with the Vicon
@@ -269,6 +323,305 @@ TEST(ViconTransformer, get_frame)
         Eigen::Matrix4d::Identity());
 }
 
+TEST(ViconTransformer, subject_handle)
+{
+    ViconTransformer vtf(get_receiver("frame_with_missing_subjects.json"),
+                         "Marker Ballmaschine");
+    vtf.update();
+
+    vicon_transformer::SubjectHandle arm = vtf.resolve("Marker_Arm");
+    vicon_transformer::SubjectHandle stick = vtf.resolve("rll_led_stick");
+
+    EXPECT_TRUE(vtf.is_valid(arm));
+    EXPECT_TRUE(vtf.is_visible(arm));
+    EXPECT_FALSE(vtf.is_visible(stick));
+
+    ASSERT_MATRIX_ALMOST_EQUAL(vtf.get_transform(arm).matrix(),
+                               vtf.get_transform("Marker_Arm").matrix());
+    ASSERT_MATRIX_ALMOST_EQUAL(vtf.get_raw_transform(arm).matrix(),
+                               vtf.get_raw_transform("Marker_Arm").matrix());
+
+    // not visible -> identity
+    ASSERT_MATRIX_ALMOST_EQUAL(vtf.get_transform(stick).matrix(),
+                               Eigen::Matrix4d::Identity());
+    ASSERT_MATRIX_ALMOST_EQUAL(vtf.get_raw_transform(stick).matrix(),
+                               Eigen::Matrix4d::Identity());
+
+    EXPECT_THROW(vtf.resolve("foo"), vicon_transformer::UnknownSubjectError);
+}
+
+TEST(ViconTransformer, subject_handle_invalidation)
+{
+    ViconTransformer vtf(get_receiver("test_frame1.json"), "");
+    vtf.update();
+
+    vicon_transformer::SubjectHandle arm = vtf.resolve("Marker_Arm");
+    EXPECT_FALSE(vtf.is_valid(vicon_transformer::SubjectHandle()));
+
+    // same subjects -> handle stays valid
+    vtf.update();
+    EXPECT_TRUE(vtf.is_valid(arm));
+
+    // different subjects -> handle becomes invalid
+    ViconFrame frame = vtf.receiver()->read();
+    frame.subjects.erase("Marker Ballmaschine");
+    vtf.set_frame(frame);
+    EXPECT_FALSE(vtf.is_valid(arm));
+    EXPECT_FALSE(vtf.is_visible(arm));
+
+    arm = vtf.resolve("Marker_Arm");
+    EXPECT_TRUE(vtf.is_valid(arm));
+    EXPECT_TRUE(vtf.is_visible(arm));
+}
+
+TEST(ViconTransformer, get_flat_frame)
+{
+    ViconTransformer vtf(get_receiver("frame_ping_simple_translation.json"),
+                         "rll_ping_base");
+    vtf.update();
+
+    ViconFrame frame = vtf.get_frame();
+    vicon_transformer::FlatViconFrame flat_frame = vtf.get_flat_frame();
+
+    EXPECT_EQ(flat_frame.frame_number, frame.frame_number);
+    EXPECT_EQ(flat_frame.time_stamp, frame.time_stamp);
+    ASSERT_EQ(flat_frame.num_subjects(), frame.subjects.size());
+    for (size_t i = 0; i < flat_frame.num_subjects(); i++)
+    {
+        const std::string &name = flat_frame.subject_names->at(i);
+        ASSERT_MATRIX_ALMOST_EQUAL(flat_frame.subjects[i].global_pose.matrix(),
+                                   frame.subjects.at(name).global_pose.matrix());
+    }
+}
+
+TEST(ViconTransformer, get_frame_into)
+{
+    ViconTransformer vtf(get_receiver("frame_ping_simple_translation.json"),
+                         "rll_ping_base");
+    vtf.update();
+
+    ViconFrame expected = vtf.get_frame();
+
+    ViconFrame frame;
+    vtf.get_frame_into(frame);
+    vicon_transformer::FlatViconFrame flat_frame;
+    vtf.get_frame_into(flat_frame);
+
+    EXPECT_EQ(frame.frame_number, expected.frame_number);
+    EXPECT_EQ(flat_frame.frame_number, expected.frame_number);
+    ASSERT_EQ(frame.subjects.size(), expected.subjects.size());
+    ASSERT_EQ(flat_frame.num_subjects(), expected.subjects.size());
+    for (const auto &[name, data] : expected.subjects)
+    {
+        ASSERT_MATRIX_ALMOST_EQUAL(frame.subjects.at(name).global_pose.matrix(),
+                                   data.global_pose.matrix());
+        size_t i = flat_frame.find_subject(name).value();
+        ASSERT_MATRIX_ALMOST_EQUAL(flat_frame.subjects[i].global_pose.matrix(),
+                                   data.global_pose.matrix());
+    }
+}
+
+TEST(ViconTransformer, get_frame_after_new_frame)
+{
+    ViconTransformer vtf(get_receiver("frame_ping_simple_translation.json"),
+                         "rll_ping_base");
+    vtf.update();
+    vtf.get_frame();
+
+    // the batch-transformed poses must not be reused for a new frame
+    ViconFrame frame = vtf.receiver()->read();
+    frame.subjects.at("rll_ping_base").global_pose.translation.x() += 1.0;
+    vtf.set_frame(frame);
+
+    ViconFrame transformed = vtf.get_frame();
+    for (const auto &[name, data] : transformed.subjects)
+    {
+        if (data.is_visible)
+        {
+            ASSERT_MATRIX_ALMOST_EQUAL(data.global_pose.matrix(),
+                                       vtf.get_transform(name).matrix());
+        }
+    }
+}
+
+TEST(ViconTransformer, get_all_transforms)
+{
+    ViconTransformer vtf(get_receiver("frame_with_missing_subjects.json"),
+                         "Marker Ballmaschine");
+    vtf.update();
+
+    vicon_transformer::SubjectPoses poses = vtf.get_all_transforms();
+    ASSERT_EQ(poses.names, vtf.get_subject_names());
+    ASSERT_EQ(poses.poses.rows(),
+              static_cast<Eigen::Index>(poses.names.size()));
+    ASSERT_EQ(poses.is_visible.size(), poses.poses.rows());
+
+    for (size_t i = 0; i < poses.names.size(); i++)
+    {
+        const std::string &name = poses.names[i];
+        auto tf = vtf.try_get_transform(name);
+        ASSERT_EQ(poses.is_visible[i], tf.has_value()) << name;
+        if (tf)
+        {
+            EXPECT_TRUE(poses.poses.row(i).head<3>().transpose().isApprox(
+                tf->translation))
+                << name;
+            EXPECT_TRUE(poses.poses.row(i).tail<4>().transpose().isApprox(
+                tf->rotation.coeffs()))
+                << name;
+        }
+        else
+        {
+            EXPECT_TRUE(poses.poses.row(i).array().isNaN().all()) << name;
+        }
+    }
+    // the test frame has subjects that are not visible
+    EXPECT_FALSE(poses.is_visible.all());
+
+    // same result when converting the frame
+    vicon_transformer::SubjectPoses from_frame(vtf.get_frame());
+    EXPECT_EQ(from_frame.names, poses.names);
+    EXPECT_TRUE((from_frame.is_visible == poses.is_visible).all());
+    vicon_transformer::SubjectPoses from_flat_frame(vtf.get_flat_frame());
+    EXPECT_EQ(from_flat_frame.names, poses.names);
+    for (size_t i = 0; i < poses.names.size(); i++)
+    {
+        if (poses.is_visible[i])
+        {
+            EXPECT_TRUE(from_frame.poses.row(i).isApprox(poses.poses.row(i)));
+            EXPECT_TRUE(
+                from_flat_frame.poses.row(i).isApprox(poses.poses.row(i)));
+        }
+    }
+}
+
+TEST(ViconTransformer, get_frame_into_fixed_size)
+{
+    ViconTransformer vtf(get_receiver("frame_with_missing_subjects.json"),
+                         "Marker Ballmaschine");
+    vtf.update();
+
+    auto names = vtf.get_subject_name_table();
+    ASSERT_EQ(*names, vtf.get_subject_names());
+    // same instance as long as the subjects don't change
+    vtf.update();
+    EXPECT_EQ(vtf.get_subject_name_table(), names);
+
+    // write the subjects in reverse order, skip the first one
+    std::vector<std::optional<size_t>> slots;
+    for (size_t i = 0; i < names->size(); i++)
+    {
+        slots.push_back(names->size() - 1 - i);
+    }
+    slots[0] = std::nullopt;
+
+    vicon_transformer::FixedSizeViconFrame<10> frame;
+    ASSERT_GE(frame.subjects.size(), names->size());
+    frame.subjects[names->size() - 1].is_visible = true;
+    vtf.get_frame_into(frame, slots);
+
+    ViconFrame expected = vtf.get_frame();
+    EXPECT_EQ(frame.frame_number, expected.frame_number);
+    EXPECT_EQ(frame.time_stamp, expected.time_stamp);
+    EXPECT_EQ(frame.latency, expected.latency);
+    // skipped subject is marked as not visible
+    EXPECT_FALSE(frame.subjects[names->size() - 1].is_visible);
+    for (size_t i = 1; i < names->size(); i++)
+    {
+        const auto &expected_subject = expected.subjects.at(names->at(i));
+        const auto &subject = frame.subjects[*slots[i]];
+        ASSERT_EQ(subject.is_visible, expected_subject.is_visible);
+        if (subject.is_visible)
+        {
+            EXPECT_EQ(subject.quality, expected_subject.quality);
+            ASSERT_MATRIX_ALMOST_EQUAL(subject.global_pose.matrix(),
+                                       expected_subject.global_pose.matrix());
+        }
+    }
+}
+
+TEST(ViconTransformer, get_transform_at)
+{
+    ViconTransformer vtf(get_receiver("test_frame1.json"), "");
+    vtf.update();
+
+    // history is disabled by default
+    EXPECT_EQ(vtf.get_history_size(), 0u);
+    EXPECT_FALSE(vtf.get_transform_at("Marker_Arm", vtf.get_timestamp_ns()));
+
+    vtf.set_history_size(10);
+    ViconFrame frame = vtf.receiver()->read();
+    Transformation pose = frame.subjects.at("Marker_Arm").global_pose;
+
+    frame.time_stamp = 1000;
+    vtf.set_frame(frame);
+
+    frame.time_stamp = 2000;
+    frame.subjects.at("Marker_Arm").global_pose.translation +=
+        Eigen::Vector3d(1, 0, 0);
+    vtf.set_frame(frame);
+
+    auto tf = vtf.get_transform_at("Marker_Arm", 1500);
+    ASSERT_TRUE(tf);
+    Transformation expected = pose;
+    expected.translation += Eigen::Vector3d(0.5, 0, 0);
+    ASSERT_MATRIX_ALMOST_EQUAL(tf->matrix(), expected.matrix());
+
+    vicon_transformer::SubjectHandle arm = vtf.resolve("Marker_Arm");
+    tf = vtf.get_transform_at(arm, 1500);
+    ASSERT_TRUE(tf);
+    ASSERT_MATRIX_ALMOST_EQUAL(tf->matrix(), expected.matrix());
+
+    EXPECT_FALSE(vtf.get_transform_at("Marker_Arm", 2001));
+    EXPECT_FALSE(
+        vtf.get_transform_at(vicon_transformer::SubjectHandle(), 1500));
+}
+
+TEST(ViconTransformer, latency_compensation)
+{
+    ViconTransformer vtf(get_receiver("test_frame1.json"), "");
+    vtf.update();
+    EXPECT_FALSE(vtf.is_latency_compensation_enabled());
+
+    // 1 frame at 100 Hz = 10 ms, latency + offset = 20 ms -> factor 2
+    ViconFrame frame = vtf.receiver()->read();
+    frame.frame_rate = 100.0;
+    frame.latency = 0.015;
+    Transformation pose = frame.subjects.at("Marker_Arm").global_pose;
+
+    vtf.set_latency_compensation(true, 0.005);
+    EXPECT_TRUE(vtf.is_latency_compensation_enabled());
+
+    frame.frame_number = 100;
+    vtf.set_frame(frame);
+    // no previous frame -> no prediction
+    ASSERT_MATRIX_ALMOST_EQUAL(vtf.get_transform("Marker_Arm").matrix(),
+                               pose.matrix());
+
+    frame.frame_number = 101;
+    frame.subjects.at("Marker_Arm").global_pose.translation +=
+        Eigen::Vector3d(0.1, 0, 0);
+    vtf.set_frame(frame);
+
+    Transformation expected = pose;
+    expected.translation += Eigen::Vector3d(0.3, 0, 0);
+    ASSERT_MATRIX_ALMOST_EQUAL(vtf.get_transform("Marker_Arm").matrix(),
+                               expected.matrix());
+    ASSERT_MATRIX_ALMOST_EQUAL(
+        vtf.get_frame().subjects.at("Marker_Arm").global_pose.matrix(),
+        expected.matrix());
+
+    // raw poses are not affected
+    ASSERT_MATRIX_ALMOST_EQUAL(
+        vtf.get_raw_transform("Marker_Arm").matrix(),
+        frame.subjects.at("Marker_Arm").global_pose.matrix());
+
+    vtf.set_latency_compensation(false);
+    ASSERT_MATRIX_ALMOST_EQUAL(
+        vtf.get_transform("Marker_Arm").matrix(),
+        frame.subjects.at("Marker_Arm").global_pose.matrix());
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
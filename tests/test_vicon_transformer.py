@@ -331,3 +331,34 @@ def test_subject_not_present(test_data) -> None:
 
     with pytest.raises(SubjectNotVisibleError, match="rll_muscle_racket"):
         vicon.get_transform("rll_muscle_racket")
+
+
+def test_get_all_transforms(test_data) -> None:
+    vicon = ViconTransformer(
+        JsonReceiver(test_data / "frame_with_missing_subjects.json"), ORIGIN_SUBJECT
+    )
+    vicon.update()
+
+    names, poses, is_visible = vicon.get_all_transforms()
+    assert names == vicon.get_subject_names()
+    assert poses.shape == (len(names), 7)
+    assert poses.dtype == np.float64
+    assert is_visible.shape == (len(names),)
+    assert not is_visible.all()
+
+    for name, pose, visible in zip(names, poses, is_visible):
+        tf = vicon.try_get_transform(name)
+        assert visible == (tf is not None), name
+        if visible:
+            np.testing.assert_array_almost_equal(pose[:3], tf.translation)
+            np.testing.assert_array_almost_equal(pose[3:], tf.rotation.as_quat())
+        else:
+            assert np.isnan(pose).all()
+
+    # frames provide the poses in the same format
+    frame_names, frame_poses, frame_visible = vicon.get_frame().get_all_poses()
+    assert frame_names == names
+    np.testing.assert_array_equal(frame_visible, is_visible)
+    np.testing.assert_array_almost_equal(
+        frame_poses[is_visible], poses[is_visible]
+    )
@@ -10,20 +10,52 @@ generally difficult to set precisely).
 """
 from __future__ import annotations
 
+import typing
+
 import spatial_transformation
 
 from .vicon_transformer_bindings import (
     BadResultError,
+    ColumnarRecording,
+    FlatViconFrame,
     NotConnectedError,
+    PackedViconFrame1,
+    PackedViconFrame2,
+    PackedViconFrame3,
+    PackedViconFrame4,
+    PackedViconFrame5,
+    PackedViconFrame6,
+    PackedViconFrame7,
+    PackedViconFrame8,
+    PackedViconFrame9,
+    PackedViconFrame10,
+    PackedViconFrame11,
+    PackedViconFrame12,
+    PackedViconFrame13,
+    PackedViconFrame14,
+    PackedViconFrame15,
+    PackedViconFrame16,
     PlaybackReceiver,
+    RecoveryResult,
+    SharedMemoryPublisher,
+    SharedMemoryReceiver,
     SubjectData,
+    SubjectHandle,
     SubjectNotVisibleError,
     UnknownSubjectError,
     ViconFrame,
     ViconReceiver as _ViconReceiver,
     ViconReceiverConfig,
     ViconTransformer as _ViconTransformer,
+    convert_to_recording,
+    export_columnar_recording,
+    get_packed_history_since,
+    get_packed_latest,
+    load_recording_columns,
+    read_o80_subject_names,
+    recover_recording,
     to_json,
+    to_packed_array,
     from_json,
 )
 
@@ -49,24 +81,88 @@ class ViconReceiver(_ViconReceiver):
 class ViconTransformer(_ViconTransformer):
     """Wrapper around ViconTransformer implementedin C++."""
 
-    def get_transform(self, subject_name: str) -> spatial_transformation.Transformation:
-        """Get transformation of a subject relative to the origin subject."""
+    def get_transform(
+        self, subject: str | SubjectHandle
+    ) -> spatial_transformation.Transformation:
+        """Get transformation of a subject relative to the origin subject.
+
+        The subject can be specified either by name or by a handle obtained via
+        :meth:`resolve`.
+        """
         return spatial_transformation.Transformation.from_cpp(
-            self._get_transform_cpp(subject_name)
+            self._get_transform_cpp(subject)
         )
 
+    def try_get_transform(
+        self, subject: str | SubjectHandle
+    ) -> typing.Optional[spatial_transformation.Transformation]:
+        """Get transformation of a subject relative to the origin subject.
+
+        Like :meth:`get_transform` but returns None instead of raising an error if
+        the subject is unknown or not visible.
+        """
+        tf = self._try_get_transform_cpp(subject)
+        if tf is None:
+            return None
+        return spatial_transformation.Transformation.from_cpp(tf)
+
+    def get_transform_at(
+        self, subject: str | SubjectHandle, time_stamp_ns: int
+    ) -> typing.Optional[spatial_transformation.Transformation]:
+        """Get transformation of a subject relative to the origin subject at the
+        given time.
+
+        The pose is interpolated from the history of past frames (see
+        :meth:`set_history_size`).  Returns None if the time is not covered by the
+        history or the subject is not visible at that time.
+        """
+        tf = self._get_transform_at_cpp(subject, time_stamp_ns)
+        if tf is None:
+            return None
+        return spatial_transformation.Transformation.from_cpp(tf)
+
 
 __all__ = (
     "BadResultError",
+    "ColumnarRecording",
+    "FlatViconFrame",
     "NotConnectedError",
+    "PackedViconFrame1",
+    "PackedViconFrame2",
+    "PackedViconFrame3",
+    "PackedViconFrame4",
+    "PackedViconFrame5",
+    "PackedViconFrame6",
+    "PackedViconFrame7",
+    "PackedViconFrame8",
+    "PackedViconFrame9",
+    "PackedViconFrame10",
+    "PackedViconFrame11",
+    "PackedViconFrame12",
+    "PackedViconFrame13",
+    "PackedViconFrame14",
+    "PackedViconFrame15",
+    "PackedViconFrame16",
     "PlaybackReceiver",
+    "RecoveryResult",
+    "SharedMemoryPublisher",
+    "SharedMemoryReceiver",
     "SubjectData",
+    "SubjectHandle",
     "SubjectNotVisibleError",
     "UnknownSubjectError",
     "ViconFrame",
     "ViconReceiver",
     "ViconReceiverConfig",
     "ViconTransformer",
+    "convert_to_recording",
+    "export_columnar_recording",
+    "get_packed_history_since",
+    "get_packed_latest",
+    "load_recording_columns",
+    "read_o80_subject_names",
+    "recover_recording",
     "to_json",
+    "to_packed_array",
     "from_json",
 )
@@ -1,8 +1,10 @@
 # SPDX-License-Identifier: BSD-3-Clause
 """ROS Node that publishes TF transforms for Vicon objects."""
 import contextlib
+import itertools
 
 import rclpy
+from builtin_interfaces.msg import Time
 from geometry_msgs.msg import TransformStamped
 from rclpy.node import Node
 from tf2_ros import TransformBroadcaster
@@ -11,7 +13,6 @@ from vicon_transformer import (
     ViconReceiver,
     ViconReceiverConfig,
     ViconTransformer,
-    SubjectNotVisibleError,
 )
 
 
@@ -49,22 +50,22 @@ class FramePublisher(Node):
             while rclpy.ok():
                 vicon.update()
 
-                for subject_name in vicon.get_subject_names():
-                    try:
-                        transform = vicon.get_transform(subject_name)
-                    except SubjectNotVisibleError:
-                        # skip the subject if it is not present
-                        continue
-
+                if self.use_wall_time:
+                    stamp = self.get_clock().now().to_msg()
+                else:
+                    timestamp_s = vicon.get_timestamp_ns() / 1e9
+                    stamp = Time()
+                    stamp.sec = int(timestamp_s)
+                    stamp.nanosec = int((timestamp_s % 1) * 1e9)
+
+                # get all poses in one call instead of one call per subject
+                names, poses, is_visible = vicon.get_all_transforms()
+                tf_msgs = []
+                visible_names = itertools.compress(names, is_visible)
+                visible_poses = poses[is_visible].tolist()
+                for subject_name, pose in zip(visible_names, visible_poses):
                     tf_msg = TransformStamped()
-
-                    if self.use_wall_time:
-                        tf_msg.header.stamp = self.get_clock().now().to_msg()
-                    else:
-                        timestamp_s = vicon.get_timestamp_ns() / 1e9
-                        tf_msg.header.stamp.sec = int(timestamp_s)
-                        tf_msg.header.stamp.nanosec = int((timestamp_s % 1) * 1e9)
-
+                    tf_msg.header.stamp = stamp
                     tf_msg.header.frame_id = "world"
                     tf_msg.child_frame_id = subject_name
 
@@ -72,17 +73,16 @@ class FramePublisher(Node):
                         tf_msg.transform.translation.x,
                         tf_msg.transform.translation.y,
                         tf_msg.transform.translation.z,
-                    ) = transform.translation
-
-                    (
                         tf_msg.transform.rotation.x,
                         tf_msg.transform.rotation.y,
                         tf_msg.transform.rotation.z,
                         tf_msg.transform.rotation.w,
-                    ) = transform.rotation.as_quat()
+                    ) = pose
+
+                    tf_msgs.append(tf_msg)
 
-                    # Send the transformation
-                    self.tf_broadcaster.sendTransform(tf_msg)
+                # Send the transformations
+                self.tf_broadcaster.sendTransform(tf_msgs)
 
 
 def main() -> None: